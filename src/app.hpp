@@ -8,7 +8,10 @@
 #include <external/vk_mem_alloc.h>
 
 #include <iostream>
+#include <fstream>
+#include <filesystem>
 #include <vector>
+#include <cmath>
 
 #include <hdvw/window.hpp>
 #include <hdvw/instance.hpp>
@@ -23,17 +26,30 @@
 #include <hdvw/framebuffer.hpp>
 #include <hdvw/shader.hpp>
 #include <hdvw/pipelinelayout.hpp>
+#include <hdvw/pipelinecache.hpp>
 #include <hdvw/pipeline.hpp>
+#include <hdvw/pipelinecompiler.hpp>
 #include <hdvw/semaphore.hpp>
 #include <hdvw/fence.hpp>
 #include <hdvw/vertex.hpp>
+#include <hdvw/stagingring.hpp>
+#include <hdvw/upload.hpp>
 #include <hdvw/databuffer.hpp>
+#include <hdvw/geometryarena.hpp>
+#include <hdvw/uniformring.hpp>
 #include <hdvw/texture.hpp>
+#include <hdvw/resourcecache.hpp>
 #include <hdvw/descriptorlayout.hpp>
+#include <hdvw/layoutcache.hpp>
 #include <hdvw/descriptorpool.hpp>
 #include <hdvw/descriptorset.hpp>
 
+#include <water/shallowwater.hpp>
+
 #define MAX_FRAMES_IN_FLIGHT 3
+#define DEFRAGMENT_INTERVAL 3600
+#define WATER_SIZE 512
+#define WATER_STEPS_PER_FRAME 4
 
 struct MVP {
     glm::mat4 model;
@@ -50,20 +66,37 @@ class App {
         hd::Surface surface;
         hd::Device device;
         hd::Allocator allocator;
+        hd::StagingRing stagingRing;
         hd::Queue graphicsQueue;
         hd::Queue presentQueue;
+        hd::Queue transferQueue;
         hd::CommandPool graphicsPool;
+        hd::UploadContext uploadContext;
 
         std::vector<hd::Semaphore> imageAvailable;
         std::vector<hd::Semaphore> renderFinished;
         std::vector<hd::Fence> inFlightFences;
 
-        hd::DataBuffer<hd::Vertex> vertexBuffer;
-        hd::DataBuffer<uint32_t> indexBuffer;
+        hd::GeometryArena geometryArena;
+        hd::GeometryAllocation quad;
 
+        hd::ResourceCache resourceCache;
         hd::Texture texture;
-        hd::DataBuffer<MVP> unibuffer;
+        hd::UniformRing uniformRing;
+        hd::Shader triangleVertex;
+        hd::Shader triangleFragment;
+        hd::LayoutCache layoutCache;
         hd::DescriptorLayout descriptorLayout;
+        hd::PipelineLayout pipelineLayout;
+        hd::DescriptorPool descriptorPool;
+        std::vector<hd::DescriptorSet> descriptorSets;
+        std::vector<uint64_t> descriptorGenerations;
+        std::vector<hd::CommandBuffer> commandBuffers;
+
+        hd::ShallowWater water;
+        float waterTimeStep;
+
+        MVP transform;
 
         void init() {
             window = hd::Window_t::conjure({
@@ -95,8 +128,18 @@ class App {
                     .surface = surface,
                     .findQueueFamilies = customFindQueueFamilies,
                     .extensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME },
+                    .optionalExtensions = {
+                        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+                        VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME,
+#ifdef VK_EXT_graphics_pipeline_library
+                        VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+                        VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+#endif
+                    },
                     .features = vk::PhysicalDeviceFeatures({ .samplerAnisotropy = VK_TRUE }),
+                    .optionalFeatures = vk::PhysicalDeviceFeatures({ .textureCompressionBC = VK_TRUE }),
                     .validationLayers = { "VK_LAYER_KHRONOS_validation" },
+                    .framesInFlight = MAX_FRAMES_IN_FLIGHT,
                     });
 
             allocator = hd::Allocator_t::conjure({
@@ -104,6 +147,25 @@ class App {
                     .device = device,
                     });
 
+            allocator->createPool({
+                    .name = "uniforms",
+                    .memoryUsage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+                    .bufferUsage = vk::BufferUsageFlagBits::eUniformBuffer,
+                    .blockSize = 4 * 1024 * 1024,
+                    });
+
+            allocator->createPool({
+                    .name = "attachments",
+                    .strategy = hd::PoolStrategy::eDedicated,
+                    .imageUsage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment,
+                    .format = hd::findDepthFormat(device),
+                    });
+
+            stagingRing = hd::StagingRing_t::conjure({
+                    .device = device,
+                    .allocator = allocator,
+                    });
+
             graphicsQueue = hd::Queue_t::conjure({
                     .device = device,
                     .type = hd::QueueType::eGraphics,
@@ -114,9 +176,22 @@ class App {
                     .type = hd::QueueType::ePresent,
                     });
 
+            transferQueue = hd::Queue_t::conjure({
+                    .device = device,
+                    .type = hd::QueueType::eTransfer,
+                    });
+
             graphicsPool = hd::CommandPool_t::conjure({
                     .device = device,
                     .family = hd::PoolFamily::eGraphics,
+                    .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                    });
+
+            uploadContext = hd::UploadContext_t::conjure({
+                    .device = device,
+                    .stagingRing = stagingRing,
+                    .transferQueue = transferQueue,
+                    .graphicsQueue = graphicsQueue,
                     });
 
             imageAvailable.resize(MAX_FRAMES_IN_FLIGHT);
@@ -136,146 +211,179 @@ class App {
                 {{-0.5f,  0.5f,  0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
             };
 
-            vertexBuffer = hd::DataBuffer_t<hd::Vertex>::conjure({
-                    .commandPool = graphicsPool,
-                    .queue = graphicsQueue,
-                    .allocator = allocator,
-                    .data = vertices,
-                    .usage = vk::BufferUsageFlagBits::eVertexBuffer,
-                    });
+            auto uploadBatch = hd::UploadBatch_t::conjure({ .uploadContext = uploadContext });
 
             const std::vector<uint32_t> indices = {
                 0, 1, 2, 2, 3, 0
             };
 
-            indexBuffer = hd::DataBuffer_t<uint32_t>::conjure({
-                    .commandPool = graphicsPool,
-                    .queue = graphicsQueue,
+            geometryArena = hd::GeometryArena_t::conjure({
+                    .device = device,
                     .allocator = allocator,
-                    .data = indices,
-                    .usage = vk::BufferUsageFlagBits::eIndexBuffer,
                     });
+
+            quad = geometryArena->allocate(uploadBatch, vertices, indices);
             
-            texture = hd::Texture_t::conjure({
-                    .filename = "lizard.jpg",
-                    .commandPool = graphicsPool,
-                    .queue = graphicsQueue,
-                    .allocator = allocator,
+            uploadBatch->flush();
+
+            resourceCache = hd::ResourceCache_t::conjure({
                     .device = device,
+                    .allocator = allocator,
+                    .uploadContext = uploadContext,
                     });
 
-            vk::DescriptorSetLayoutBinding textureBinding{
-                0, // binding
-                vk::DescriptorType::eCombinedImageSampler, // descriptorType
-                1, // descriptorCount
-                vk::ShaderStageFlagBits::eFragment, // stageFlags
-                nullptr, // pImmutableSamplers
-            };
-
-            MVP transform {
-                glm::mat4(1.0f),
-                glm::mat4(1.0f),
-                glm::mat4(1.0f),
-            };
+            // Cooked by the assets target into BC formats, the source image still works without either
+            bool compressed = device->features().textureCompressionBC && std::filesystem::exists("lizard.ktx2");
+            texture = resourceCache->texture(compressed ? "lizard.ktx2" : "lizard.jpg");
 
-            unibuffer = hd::DataBuffer_t<MVP>::conjure({
-                    .commandPool = graphicsPool,
-                    .queue = graphicsQueue,
+            uniformRing = hd::UniformRing_t::conjure({
+                    .device = device,
                     .allocator = allocator,
-                    .data = {transform},
-                    .usage = vk::BufferUsageFlagBits::eUniformBuffer,
-                    .memoryUsage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+                    .frames = MAX_FRAMES_IN_FLIGHT,
+                    .pool = "uniforms",
                     });
 
-            vk::DescriptorSetLayoutBinding uniformBinding{
-                1,
-                vk::DescriptorType::eUniformBuffer,
-                1,
-                vk::ShaderStageFlagBits::eVertex,
-                nullptr,
-            };
+            triangleVertex = hd::Shader_t::conjure({
+                    .device = device,
+                    .filename = "shaders/triangle.vert.spv",
+                    .stage = vk::ShaderStageFlagBits::eVertex,
+                    });
 
-            descriptorLayout = hd::DescriptorLayout_t::conjure({
+            triangleFragment = hd::Shader_t::conjure({
                     .device = device,
-                    .bindings = {textureBinding, uniformBinding},
+                    .filename = "shaders/triangle.frag.spv",
+                    .stage = vk::ShaderStageFlagBits::eFragment,
                     });
-        }
 
-        hd::SwapChain swapChain;
-        hd::DescriptorPool descriptorPool;
-        std::vector<hd::DescriptorSet> descriptorSets;
-        std::vector<hd::Fence> inFlightImages;
-        hd::RenderPass renderPass;
-        std::vector<hd::Framebuffer> framebuffers;
-        hd::PipelineLayout pipelineLayout;
-        hd::Pipeline pipeline;
-        std::vector<hd::CommandBuffer> commandBuffers;
+            layoutCache = hd::LayoutCache_t::conjure({ .device = device });
 
-        void setup() {
-            swapChain = hd::SwapChain_t::conjure(hd::SwapChainCreateInfo{
-                    .window = window,
-                    .surface = surface,
-                    .allocator = allocator,
-                    .device = device,
-                    .presentMode = vk::PresentModeKHR::eMailbox,
+            // The transform lives in the uniform ring, so its binding takes a dynamic offset
+            auto layout = layoutCache->reflect({
+                    .shaders = { triangleVertex, triangleFragment },
+                    .dynamic = {{ 0, 1 }},
                     });
 
+            descriptorLayout = layout.descriptorLayouts[0];
+            pipelineLayout = layout.pipelineLayout;
+
             descriptorPool = hd::DescriptorPool_t::conjure({
                     .device = device,
                     .layouts = {{descriptorLayout, 1}},
-                    .instances = swapChain->length(),
+                    .instances = MAX_FRAMES_IN_FLIGHT,
                     });
 
             descriptorSets = descriptorPool->allocate(1, descriptorLayout);
+            descriptorGenerations.resize(MAX_FRAMES_IN_FLIGHT);
 
-            for (auto& set: descriptorSets) {
-                vk::DescriptorImageInfo ii = {};
-                ii.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-                ii.imageView = texture->view();
-                ii.sampler = texture->sampler();
-
-                vk::WriteDescriptorSet ws = {};
-                ws.dstBinding = 0;
-                ws.dstArrayElement = 0;
-                ws.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-                ws.descriptorCount = 1;
-
-                set->update({ .writeSet = ws, .imageInfo = ii, });
-
-                vk::DescriptorBufferInfo bi = {};
-                bi.buffer = unibuffer->raw();
-                bi.offset = 0;
-                bi.range = sizeof(MVP);
+            for (uint32_t iter = 0; iter < MAX_FRAMES_IN_FLIGHT; iter++) {
+                writeTexture(iter);
 
                 vk::WriteDescriptorSet ws2 = {};
                 ws2.dstBinding = 1;
                 ws2.dstArrayElement = 0;
-                ws2.descriptorType = vk::DescriptorType::eUniformBuffer;
+                ws2.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
                 ws2.descriptorCount = 1;
 
-                set->update({ .writeSet = ws2, .bufferInfo = bi, });
+                descriptorSets[iter]->update({ .writeSet = ws2, .bufferInfo = uniformRing->descriptor(sizeof(MVP)), });
             }
 
+            commandBuffers = graphicsPool->allocate(MAX_FRAMES_IN_FLIGHT);
+
+            createWater();
+        }
+
+        // Dam break over a bump, the left third of a 5 metre pool starts a metre deep
+        void createWater() {
+            std::vector<float> bathymetry(WATER_SIZE * WATER_SIZE);
+            std::vector<float> depth(WATER_SIZE * WATER_SIZE);
+            for (uint32_t y = 0; y < WATER_SIZE; y++)
+                for (uint32_t x = 0; x < WATER_SIZE; x++) {
+                    float dx = (float) x / WATER_SIZE - 0.5f;
+                    float dy = (float) y / WATER_SIZE - 0.5f;
+                    float bed = 0.2f * std::exp(-200.0f * (dx * dx + dy * dy));
+
+                    bathymetry[y * WATER_SIZE + x] = bed;
+                    depth[y * WATER_SIZE + x] = x < WATER_SIZE / 3 ? 1.0f - bed : 0.0f;
+                }
+
+            water = hd::ShallowWater_t::conjure({
+                    .device = device,
+                    .allocator = allocator,
+                    .uploadContext = uploadContext,
+                    .layoutCache = layoutCache,
+                    .queue = graphicsQueue,
+                    .commandPool = graphicsPool,
+                    .width = WATER_SIZE,
+                    .height = WATER_SIZE,
+                    .cellSize = 5.0f / WATER_SIZE,
+                    .bathymetry = bathymetry,
+                    .depth = depth,
+                    .frames = MAX_FRAMES_IN_FLIGHT,
+                    });
+
+            // The front of a dam break runs at twice the wave speed of the water behind it
+            waterTimeStep = water->stableTimeStep(1.0f, 2.0f * std::sqrt(9.81f));
+
+            water->step(waterTimeStep, 256);
+            std::cout << "Shallow water: " << water->cellUpdatesPerSecond() / 1e6 << " million cell updates/s" << std::endl;
+        }
+
+        // Rewritten whenever defragmentation has moved the texture, only once the frame's fence has been waited on
+        void writeTexture(uint32_t frame) {
+            vk::DescriptorImageInfo ii = {};
+            ii.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+            ii.imageView = texture->view();
+            ii.sampler = texture->sampler();
+
+            vk::WriteDescriptorSet ws = {};
+            ws.dstBinding = 0;
+            ws.dstArrayElement = 0;
+            ws.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+            ws.descriptorCount = 1;
+
+            descriptorSets[frame]->update({ .writeSet = ws, .imageInfo = ii, });
+            descriptorGenerations[frame] = texture->generation();
+        }
+
+        hd::SwapChain swapChain;
+        std::vector<hd::Fence> inFlightImages;
+        hd::RenderPass renderPass;
+        std::vector<hd::Framebuffer> framebuffers;
+        hd::PipelineCache pipelineCache;
+        hd::PipelineCompiler pipelineCompiler;
+        hd::Pipeline pipeline;
+
+        void createSwapChain(hd::SwapChain oldSwapChain) {
+            swapChain = hd::SwapChain_t::conjure(hd::SwapChainCreateInfo{
+                    .window = window,
+                    .surface = surface,
+                    .allocator = allocator,
+                    .device = device,
+                    .presentMode = vk::PresentModeKHR::eMailbox,
+                    .depthPool = "attachments",
+                    .oldSwapChain = oldSwapChain,
+                    });
+
             float aspect = (float) swapChain->extent().height / (float) swapChain->extent().width;
             
-            MVP orthoProj {
+            transform = {
                 glm::mat4(1.0f),
                 glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
                 glm::ortho(-1.0f, 1.0f, -1.0f * aspect, 1.0f * aspect, 0.1f, 100.0f),
             };
 
-            void* data;
-            allocator->map(unibuffer->memory(), data);
-            memcpy(data, &orthoProj, sizeof(MVP));
-            allocator->unmap(unibuffer->memory());
-
-            inFlightImages.resize(swapChain->length(), nullptr);
+            inFlightImages.assign(swapChain->length(), nullptr);
+        }
 
+        void createRenderPass() {
             renderPass = hd::SwapChainRenderPass_t::conjure({
                         .swapChain = swapChain,
                         .device = device,
                         });
+        }
 
+        void createFramebuffers() {
+            framebuffers.clear();
             framebuffers.reserve(swapChain->length());
             for (uint32_t index = 0; index < swapChain->length(); index++)
                 framebuffers.push_back(hd::Framebuffer_t::conjure({
@@ -283,77 +391,94 @@ class App {
                             .device = device,
                             .attachments = {
                                 swapChain->colorAttachment(index)->view(),
-                                swapChain->depthAttachment(index)->view(),
+                                swapChain->depthAttachment()->view(),
                             },
                             .extent = swapChain->extent(),
                             }));
+        }
 
-            hd::Shader triangleVertex = hd::Shader_t::conjure({
-                    .device = device,
-                    .filename = "shaders/triangle.vert.spv",
-                    .stage = vk::ShaderStageFlagBits::eVertex,
-                    });
-
-            hd::Shader triangleFragment = hd::Shader_t::conjure({
-                    .device = device,
-                    .filename = "shaders/triangle.frag.spv",
-                    .stage = vk::ShaderStageFlagBits::eFragment,
-                    });
-
-            pipelineLayout = hd::PipelineLayout_t::conjure({
-                    .device = device,
-                    .descriptorLayouts = {descriptorLayout->raw()},
-                    });
-
-            pipeline = hd::DefaultPipeline_t::conjure({
+        // Every pipeline the app draws with, compiled together on the workers
+        std::vector<hd::DefaultPipelineCreateInfo> pipelineDescriptions() {
+            return {
+                {
                     .pipelineLayout = pipelineLayout,
                     .renderPass = renderPass,
                     .device = device,
                     .shaderInfo = { triangleVertex->info(), triangleFragment->info() },
-                    .extent = swapChain->extent(),
+                    .shaders = { triangleVertex, triangleFragment },
                     .cullMode = vk::CullModeFlagBits::eBack,
                     .frontFace = vk::FrontFace::eClockwise,
                     .checkDepth = true,
+                    .pipelineCache = pipelineCache,
+                },
+            };
+        }
+
+        void setup() {
+            createSwapChain(nullptr);
+            createRenderPass();
+
+            pipelineCache = hd::PipelineCache_t::conjure({
+                    .device = device,
+                    .filename = "pipeline.cache",
                     });
 
-            commandBuffers = graphicsPool->allocate(framebuffers.size());
+            pipelineCompiler = hd::PipelineCompiler_t::conjure({});
 
-            // Record
-            std::vector<vk::DeviceSize> offsets = { 0 };
-            for (uint32_t iter = 0; iter < framebuffers.size(); iter++) {
-                commandBuffers[iter]->begin();
-                commandBuffers[iter]->beginRenderPass({
-                        .renderPass = renderPass,
-                        .framebuffer = framebuffers[iter],
-                        .extent = swapChain->extent(),
-                        });
+            // The framebuffers are made while the pipelines compile
+            auto pipelines = pipelineCompiler->compile(pipelineDescriptions());
+            createFramebuffers();
+            pipeline = pipelines[0].get();
+        }
+
+        // Only what depends on the swapchain images is rebuilt, the replaced objects go
+        // through the deletion queue so frames still in flight keep working
+        void resize() {
+            device->updateSurfaceInfo();
+
+            auto format = swapChain->format();
+            auto depthFormat = swapChain->depthFormat();
+
+            createSwapChain(swapChain);
 
-                commandBuffers[iter]->raw().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout->raw(), 0, descriptorSets[iter]->raw(), nullptr);
-                commandBuffers[iter]->raw().bindVertexBuffers(0, vertexBuffer->raw(), offsets);
-                commandBuffers[iter]->raw().bindIndexBuffer(indexBuffer->raw(), 0, vk::IndexType::eUint32);
-                commandBuffers[iter]->raw().bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->raw());
-                commandBuffers[iter]->raw().drawIndexed(indexBuffer->count(), 1, 0, 0, 0);
+            bool formatChanged = format != swapChain->format() || depthFormat != swapChain->depthFormat();
+            if (formatChanged)
+                createRenderPass();
 
-                commandBuffers[iter]->endRenderPass(commandBuffers[iter]);
-                commandBuffers[iter]->end();
+            createFramebuffers();
+
+            // The viewport is dynamic, only a new render pass needs a new pipeline
+            if (formatChanged) {
+                pipeline = pipelineCompiler->compile(pipelineDescriptions())[0].get();
+                pipelineCompiler->purge();
             }
-            // End
         }
 
-        void cleanupRender() {
-            device->waitIdle();
+        void record(uint32_t imageIndex, uint32_t uniformOffset) {
+            auto& cmd = commandBuffers[currentFrame];
+            cmd->reset(false);
+            cmd->begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+            allocator->defragmentStep(cmd->raw());
 
-            commandBuffers.clear();
-            pipeline.reset();
-            pipelineLayout.reset();
-            framebuffers.clear();
-            renderPass.reset();
-            inFlightImages.clear();
-            descriptorSets.clear();
-            descriptorPool.reset();
-            swapChain.reset();
+            // The step above may have moved the texture, the draw below must see the new one
+            if (descriptorGenerations[currentFrame] != texture->generation())
+                writeTexture(currentFrame);
 
-            device->updateSurfaceInfo();
+            water->record(cmd, currentFrame, waterTimeStep, WATER_STEPS_PER_FRAME);
+            cmd->beginRenderPass({
+                    .renderPass = renderPass,
+                    .framebuffer = framebuffers[imageIndex],
+                    .extent = swapChain->extent(),
+                    });
+
+            cmd->raw().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout->raw(), 0, descriptorSets[currentFrame]->raw(), uniformOffset);
+            geometryArena->bind(cmd);
+            cmd->raw().bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->raw());
+            cmd->setViewport(swapChain->extent());
+            geometryArena->draw(cmd, quad);
+
+            cmd->endRenderPass(cmd);
+            cmd->end();
         }
 
         void loop() {
@@ -363,20 +488,33 @@ class App {
             }
 
             device->waitIdle();
+            allocator->endDefragmentation();
+
+            std::ofstream stats("memory.json");
+            stats << allocator->statsJson();
         }
 
         uint32_t currentFrame = 0;
+        uint64_t frameCount = 0;
 
         void update() {
             inFlightFences[currentFrame]->wait();
+            device->deletionQueue()->advance();
+            uploadContext->collect();
+            allocator->nextFrame();
+
+            // Moves must not race uploads still writing to the old locations
+            if (++frameCount % DEFRAGMENT_INTERVAL == 0 && uploadContext->idle())
+                allocator->beginDefragmentation({ .framesInFlight = MAX_FRAMES_IN_FLIGHT });
 
             uint32_t imageIndex;
             {
                 auto result = device->acquireNextImage(swapChain->raw(), imageAvailable[currentFrame]->raw());
 
+                // Nothing was acquired, so skip the frame and try again with the new swapchain
                 if (result.result == vk::Result::eErrorOutOfDateKHR) {
-                    cleanupRender();
-                    setup();
+                    resize();
+                    return;
                 } else if (result.result != vk::Result::eSuccess && result.result != vk::Result::eSuboptimalKHR)
                     throw std::runtime_error("Failed to acquire the next image");
                 imageIndex = result.value;
@@ -386,12 +524,18 @@ class App {
                 inFlightImages[imageIndex]->wait();
             inFlightImages[imageIndex] = inFlightFences[currentFrame];
 
+            uniformRing->begin(currentFrame);
+            uint32_t uniformOffset = uniformRing->push(transform);
+            uniformRing->flush();
+
+            record(imageIndex, uniformOffset);
+
             {
                 vk::Semaphore waitSemaphores[] = { imageAvailable[currentFrame]->raw() };
                 vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
                 vk::Semaphore signalSemaphores[] = { renderFinished[currentFrame]->raw() };
 
-                auto raw = commandBuffers[imageIndex]->raw();
+                auto raw = commandBuffers[currentFrame]->raw();
 
                 vk::SubmitInfo submitInfo = {};
                 submitInfo.waitSemaphoreCount = 1;
@@ -423,8 +567,7 @@ class App {
 
                 if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || framebufferResized) {
                     framebufferResized = false;
-                    cleanupRender();
-                    setup();
+                    resize();
                 } else if (result != vk::Result::eSuccess)
                     throw std::runtime_error("Failed to present the image to the swapChain");
             }
@@ -0,0 +1,215 @@
+#include <cook/bcencoder.hpp>
+using namespace hd;
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+static uint16_t pack565(const float color[3]) {
+    auto r = (uint16_t) std::clamp(std::lround(color[0] * 31.0f / 255.0f), 0l, 31l);
+    auto g = (uint16_t) std::clamp(std::lround(color[1] * 63.0f / 255.0f), 0l, 63l);
+    auto b = (uint16_t) std::clamp(std::lround(color[2] * 31.0f / 255.0f), 0l, 31l);
+    return (r << 11) | (g << 5) | b;
+}
+
+static void unpack565(uint16_t packed, float color[3]) {
+    uint32_t r = (packed >> 11) & 31;
+    uint32_t g = (packed >> 5) & 63;
+    uint32_t b = packed & 31;
+    color[0] = (float) ((r << 3) | (r >> 2));
+    color[1] = (float) ((g << 2) | (g >> 4));
+    color[2] = (float) ((b << 3) | (b >> 2));
+}
+
+// Endpoints are the extremes along the principal axis of the block, pulled in by
+// 1/16 of the range so the interpolated colours cover the cluster better.
+static void encodeColor(const uint8_t block[64], uint8_t out[8]) {
+    float pixels[3][16];
+    for (int pixel = 0; pixel < 16; pixel++)
+        for (int channel = 0; channel < 3; channel++)
+            pixels[channel][pixel] = block[pixel * 4 + channel];
+
+    float mean[3];
+    for (int channel = 0; channel < 3; channel++) {
+        float sum = 0.0f;
+        #pragma omp simd reduction(+:sum)
+        for (int pixel = 0; pixel < 16; pixel++)
+            sum += pixels[channel][pixel];
+        mean[channel] = sum / 16.0f;
+    }
+
+    float covariance[6] = {};
+    for (int pixel = 0; pixel < 16; pixel++) {
+        float r = pixels[0][pixel] - mean[0];
+        float g = pixels[1][pixel] - mean[1];
+        float b = pixels[2][pixel] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iter = 0; iter < 4; iter++) {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+        };
+        float length = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+        if (length < 1e-6f)
+            break;
+        for (int channel = 0; channel < 3; channel++)
+            axis[channel] = next[channel] / length;
+    }
+
+    float projections[16];
+    #pragma omp simd
+    for (int pixel = 0; pixel < 16; pixel++)
+        projections[pixel] = (pixels[0][pixel] - mean[0]) * axis[0]
+            + (pixels[1][pixel] - mean[1]) * axis[1]
+            + (pixels[2][pixel] - mean[2]) * axis[2];
+
+    int low = (int) (std::min_element(projections, projections + 16) - projections);
+    int high = (int) (std::max_element(projections, projections + 16) - projections);
+
+    float endpoints[2][3];
+    for (int channel = 0; channel < 3; channel++) {
+        float max = pixels[channel][high];
+        float min = pixels[channel][low];
+        float inset = (max - min) / 16.0f;
+        endpoints[0][channel] = max - inset;
+        endpoints[1][channel] = min + inset;
+    }
+
+    uint16_t color0 = pack565(endpoints[0]);
+    uint16_t color1 = pack565(endpoints[1]);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        float palette[4][3];
+        unpack565(color0, palette[0]);
+        unpack565(color1, palette[1]);
+        for (int channel = 0; channel < 3; channel++) {
+            palette[2][channel] = (2.0f * palette[0][channel] + palette[1][channel]) / 3.0f;
+            palette[3][channel] = (palette[0][channel] + 2.0f * palette[1][channel]) / 3.0f;
+        }
+
+        for (int pixel = 0; pixel < 16; pixel++) {
+            uint32_t best = 0;
+            float bestError = std::numeric_limits<float>::max();
+            for (uint32_t entry = 0; entry < 4; entry++) {
+                float error = 0.0f;
+                for (int channel = 0; channel < 3; channel++) {
+                    float delta = pixels[channel][pixel] - palette[entry][channel];
+                    error += delta * delta;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = entry;
+                }
+            }
+            indices |= best << (pixel * 2);
+        }
+    }
+
+    out[0] = color0 & 0xFF;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF;
+    out[3] = color1 >> 8;
+    for (int byte = 0; byte < 4; byte++)
+        out[4 + byte] = (indices >> (byte * 8)) & 0xFF;
+}
+
+// Always uses the eight value mode, alpha0 > alpha1 unless the block is flat
+static void encodeAlpha(const uint8_t block[64], uint8_t out[8]) {
+    uint8_t alpha[16];
+    for (int pixel = 0; pixel < 16; pixel++)
+        alpha[pixel] = block[pixel * 4 + 3];
+
+    uint8_t max = *std::max_element(alpha, alpha + 16);
+    uint8_t min = *std::min_element(alpha, alpha + 16);
+
+    uint64_t indices = 0;
+    if (max != min) {
+        int palette[8] = { max, min };
+        for (int entry = 1; entry < 7; entry++)
+            palette[entry + 1] = ((7 - entry) * max + entry * min) / 7;
+
+        for (int pixel = 0; pixel < 16; pixel++) {
+            uint64_t best = 0;
+            int bestError = std::numeric_limits<int>::max();
+            for (uint64_t entry = 0; entry < 8; entry++) {
+                int error = std::abs(alpha[pixel] - palette[entry]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = entry;
+                }
+            }
+            indices |= best << (pixel * 3);
+        }
+    }
+
+    out[0] = max;
+    out[1] = min;
+    for (int byte = 0; byte < 6; byte++)
+        out[2 + byte] = (indices >> (byte * 8)) & 0xFF;
+}
+
+std::vector<uint8_t> hd::encodeBc(vk::Format format, const uint8_t* rgba, vk::Extent2D extent) {
+    bool alpha;
+    switch (format) {
+        case vk::Format::eBc1RgbUnormBlock:
+        case vk::Format::eBc1RgbSrgbBlock:
+            alpha = false;
+            break;
+        case vk::Format::eBc3UnormBlock:
+        case vk::Format::eBc3SrgbBlock:
+            alpha = true;
+            break;
+        default:
+            throw std::invalid_argument("only BC1 and BC3 can be encoded");
+    }
+
+    uint32_t blockSize = alpha ? 16 : 8;
+    uint32_t blocksWide = (extent.width + 3) / 4;
+    uint32_t blocksHigh = (extent.height + 3) / 4;
+    std::vector<uint8_t> blocks(blocksWide * blocksHigh * blockSize);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (uint32_t by = 0; by < blocksHigh; by++) {
+        uint8_t block[64];
+
+        for (uint32_t bx = 0; bx < blocksWide; bx++) {
+            for (uint32_t y = 0; y < 4; y++) {
+                uint32_t row = std::min(by * 4 + y, extent.height - 1);
+                for (uint32_t x = 0; x < 4; x++) {
+                    uint32_t column = std::min(bx * 4 + x, extent.width - 1);
+                    memcpy(block + (y * 4 + x) * 4, rgba + (row * extent.width + column) * 4, 4);
+                }
+            }
+
+            uint8_t* out = blocks.data() + (by * blocksWide + bx) * blockSize;
+            if (alpha) {
+                encodeAlpha(block, out);
+                encodeColor(block, out + 8);
+            } else encodeColor(block, out);
+        }
+    }
+
+    return blocks;
+}
+
+bool hd::hasAlpha(const uint8_t* rgba, vk::Extent2D extent) {
+    size_t count = (size_t) extent.width * extent.height;
+    for (size_t pixel = 0; pixel < count; pixel++)
+        if (rgba[pixel * 4 + 3] != 255)
+            return true;
+    return false;
+}
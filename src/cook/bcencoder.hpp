@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace hd {
+    // Encodes one RGBA8 level into BC1 (alpha ignored) or BC3 blocks. Rows of blocks are
+    // spread over OpenMP threads, edge blocks repeat the last row or column.
+    std::vector<uint8_t> encodeBc(vk::Format format, const uint8_t* rgba, vk::Extent2D extent);
+
+    bool hasAlpha(const uint8_t* rgba, vk::Extent2D extent);
+}
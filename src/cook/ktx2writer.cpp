@@ -0,0 +1,154 @@
+#include <cook/ktx2writer.hpp>
+using namespace hd;
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    // Khronos data format values, see the KHR_DF_* enums
+    const uint8_t modelBc1a = 128;
+    const uint8_t modelBc3 = 130;
+    const uint8_t primariesBt709 = 1;
+    const uint8_t transferLinear = 1;
+    const uint8_t transferSrgb = 2;
+    const uint8_t channelColor = 0;
+    const uint8_t channelAlpha = 15;
+
+    struct Writer {
+        std::vector<uint8_t> bytes;
+
+        template<class Value>
+        void put(Value value) {
+            size_t offset = bytes.size();
+            bytes.resize(offset + sizeof(value));
+            memcpy(bytes.data() + offset, &value, sizeof(value));
+        }
+
+        template<class Value>
+        void patch(size_t offset, Value value) {
+            memcpy(bytes.data() + offset, &value, sizeof(value));
+        }
+
+        void align(size_t alignment) {
+            bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+        }
+    };
+
+    bool srgb(vk::Format format) {
+        return format == vk::Format::eBc1RgbSrgbBlock || format == vk::Format::eBc1RgbaSrgbBlock
+            || format == vk::Format::eBc3SrgbBlock;
+    }
+
+    std::vector<uint8_t> descriptor(vk::Format format) {
+        struct Sample {
+            uint16_t bitOffset;
+            uint8_t channel;
+        };
+
+        uint8_t model;
+        std::vector<Sample> samples;
+        switch (format) {
+            case vk::Format::eBc1RgbUnormBlock:
+            case vk::Format::eBc1RgbSrgbBlock:
+                model = modelBc1a;
+                samples = { { 0, channelColor } };
+                break;
+            case vk::Format::eBc3UnormBlock:
+            case vk::Format::eBc3SrgbBlock:
+                model = modelBc3;
+                samples = { { 0, channelAlpha }, { 64, channelColor } };
+                break;
+            default:
+                throw std::invalid_argument("no data format descriptor for this format");
+        }
+
+        Writer dfd;
+        uint16_t blockSize = 24 + 16 * samples.size();
+
+        dfd.put<uint32_t>(4 + blockSize);
+        dfd.put<uint32_t>(0); // Khronos vendor, basic descriptor type
+        dfd.put<uint16_t>(2);
+        dfd.put<uint16_t>(blockSize);
+        dfd.put<uint8_t>(model);
+        dfd.put<uint8_t>(primariesBt709);
+        dfd.put<uint8_t>(srgb(format) ? transferSrgb : transferLinear);
+        dfd.put<uint8_t>(0);
+
+        // 4x4x1 texels, stored as dimension - 1
+        dfd.put<uint8_t>(3);
+        dfd.put<uint8_t>(3);
+        dfd.put<uint8_t>(0);
+        dfd.put<uint8_t>(0);
+
+        dfd.put<uint8_t>(formatBlockSize(format));
+        for (int plane = 1; plane < 8; plane++)
+            dfd.put<uint8_t>(0);
+
+        for (auto& sample: samples) {
+            dfd.put<uint16_t>(sample.bitOffset);
+            dfd.put<uint8_t>(63);
+            dfd.put<uint8_t>(sample.channel);
+            dfd.put<uint32_t>(0);
+            dfd.put<uint32_t>(0);
+            dfd.put<uint32_t>(UINT32_MAX);
+        }
+
+        return dfd.bytes;
+    }
+}
+
+void hd::writeKtx2(const char* filename, vk::Format format, vk::Extent2D extent,
+        const std::vector<std::vector<uint8_t>>& levels) {
+    auto dfd = descriptor(format);
+    uint32_t levelCount = levels.size();
+
+    Writer file;
+    for (auto byte: identifier)
+        file.put<uint8_t>(byte);
+
+    file.put<uint32_t>(static_cast<uint32_t>(format));
+    file.put<uint32_t>(1); // typeSize for block compressed data
+    file.put<uint32_t>(extent.width);
+    file.put<uint32_t>(extent.height);
+    file.put<uint32_t>(0);
+    file.put<uint32_t>(0);
+    file.put<uint32_t>(1);
+    file.put<uint32_t>(levelCount);
+    file.put<uint32_t>(0);
+
+    size_t indexStart = 80;
+    uint32_t dfdOffset = indexStart + levelCount * 24;
+    file.put<uint32_t>(dfdOffset);
+    file.put<uint32_t>(dfd.size());
+    file.put<uint32_t>(0);
+    file.put<uint32_t>(0);
+    file.put<uint64_t>(0);
+    file.put<uint64_t>(0);
+
+    file.bytes.resize(dfdOffset, 0);
+    file.bytes.insert(file.bytes.end(), dfd.begin(), dfd.end());
+
+    // Mip padding is lcm(block size, 4), which is the block size for BCn
+    for (uint32_t level = levelCount; level-- > 0;) {
+        file.align(formatBlockSize(format));
+
+        size_t entry = indexStart + level * 24;
+        file.patch<uint64_t>(entry, file.bytes.size());
+        file.patch<uint64_t>(entry + 8, levels[level].size());
+        file.patch<uint64_t>(entry + 16, levels[level].size());
+
+        file.bytes.insert(file.bytes.end(), levels[level].begin(), levels[level].end());
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        throw std::runtime_error(std::string("failed to open ") + filename + " for writing");
+
+    out.write(reinterpret_cast<const char*>(file.bytes.data()), file.bytes.size());
+    if (!out)
+        throw std::runtime_error(std::string("failed to write ") + filename);
+}
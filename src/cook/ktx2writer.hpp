@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/format.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace hd {
+    // Writes a single layer KTX2 file with a basic data format descriptor. Level 0 is
+    // the largest, levels are stored smallest first with mip padding as the spec asks.
+    void writeKtx2(const char* filename, vk::Format format, vk::Extent2D extent,
+            const std::vector<std::vector<uint8_t>>& levels);
+}
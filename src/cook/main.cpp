@@ -0,0 +1,169 @@
+#include <vulkan/vulkan.hpp>
+#include <external/stb_image.h>
+
+#include <hdvw/mappedfile.hpp>
+#include <hdvw/hash.hpp>
+#include <hdvw/boxfilter.hpp>
+#include <cook/bcencoder.hpp>
+#include <cook/ktx2writer.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Bump whenever the output for an unchanged source would differ
+static const uint64_t COOK_VERSION = 1;
+static const char* CACHE_NAME = ".hdvw-cook";
+
+struct Options {
+    std::string format = "auto";
+    std::filesystem::path output;
+    bool mipmaps = true;
+    bool force = false;
+    std::vector<std::filesystem::path> sources;
+};
+
+static void usage() {
+    std::cerr << "usage: hdvw-cook [--format auto|bc1|bc3] [--output dir] [--no-mips] [--force] image...\n";
+}
+
+// Maps each output to the hash of the source and settings it was cooked from
+static std::map<std::string, uint64_t> readCache(const std::filesystem::path& path) {
+    std::map<std::string, uint64_t> cache;
+    std::ifstream file(path);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        uint64_t hash;
+        std::string output;
+        if (stream >> std::hex >> hash && std::getline(stream >> std::ws, output))
+            cache[output] = hash;
+    }
+
+    return cache;
+}
+
+static void writeCache(const std::filesystem::path& path, const std::map<std::string, uint64_t>& cache) {
+    std::ofstream file(path, std::ios::trunc);
+    for (auto& [output, hash]: cache)
+        file << std::hex << hash << ' ' << output << '\n';
+}
+
+static vk::Format cook(const std::filesystem::path& source, const std::filesystem::path& output,
+        std::span<const std::byte> data, Options& options, uint32_t& levelCount) {
+    int width, height, channels;
+    std::unique_ptr<stbi_uc, void (*)(void*)> pixels(
+            stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(data.data()), (int) data.size(),
+                &width, &height, &channels, STBI_rgb_alpha), stbi_image_free);
+
+    if (!pixels)
+        throw std::runtime_error(source.string() + ": " + stbi_failure_reason());
+
+    vk::Extent2D extent = { (uint32_t) width, (uint32_t) height };
+
+    vk::Format format;
+    if (options.format == "bc1")
+        format = vk::Format::eBc1RgbSrgbBlock;
+    else if (options.format == "bc3")
+        format = vk::Format::eBc3SrgbBlock;
+    else format = hd::hasAlpha(pixels.get(), extent) ? vk::Format::eBc3SrgbBlock : vk::Format::eBc1RgbSrgbBlock;
+
+    levelCount = options.mipmaps ? hd::mipLevelCount(extent) : 1;
+
+    std::vector<std::vector<uint8_t>> levels;
+    std::vector<uint8_t> previous;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        vk::Extent2D levelExtent = { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u) };
+
+        if (level > 0) {
+            vk::Extent2D parent = { std::max(extent.width >> (level - 1), 1u), std::max(extent.height >> (level - 1), 1u) };
+            previous = hd::downsampleSrgba8(level == 1 ? pixels.get() : previous.data(), parent, levelExtent);
+        }
+
+        levels.push_back(hd::encodeBc(format, level == 0 ? pixels.get() : previous.data(), levelExtent));
+    }
+
+    // Written next to the target first so a failed run never leaves a truncated texture behind
+    auto temporary = output;
+    temporary += ".tmp";
+    hd::writeKtx2(temporary.string().c_str(), format, extent, levels);
+    std::filesystem::rename(temporary, output);
+
+    return format;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+
+    for (int arg = 1; arg < argc; arg++) {
+        std::string value = argv[arg];
+
+        if (value == "--format" && arg + 1 < argc)
+            options.format = argv[++arg];
+        else if (value == "--output" && arg + 1 < argc)
+            options.output = argv[++arg];
+        else if (value == "--no-mips")
+            options.mipmaps = false;
+        else if (value == "--force")
+            options.force = true;
+        else if (value.starts_with("--")) {
+            usage();
+            return EXIT_FAILURE;
+        } else options.sources.push_back(value);
+    }
+
+    if (options.sources.empty() || (options.format != "auto" && options.format != "bc1" && options.format != "bc3")) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    std::string settings = options.format + (options.mipmaps ? " mips " : " nomips ") + std::to_string(COOK_VERSION);
+    int failures = 0;
+
+    for (auto& source: options.sources) {
+        auto directory = options.output.empty() ? source.parent_path() : options.output;
+        auto output = directory / source.filename().replace_extension(".ktx2");
+        auto cachePath = directory / CACHE_NAME;
+
+        try {
+            if (!directory.empty())
+                std::filesystem::create_directories(directory);
+
+            auto file = hd::MappedFile_t::conjure({ .filename = source.string().c_str() });
+            uint64_t hash = hd::fnv1a(std::as_bytes(std::span(settings)), hd::fnv1a(file->data()));
+
+            auto cache = readCache(cachePath);
+            auto key = output.filename().string();
+
+            if (!options.force && cache.count(key) && cache[key] == hash && std::filesystem::exists(output)) {
+                std::cout << "unchanged " << source.string() << '\n';
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            uint32_t levels;
+            auto format = cook(source, output, file->data(), options, levels);
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+            cache[key] = hash;
+            writeCache(cachePath, cache);
+
+            std::cout << "cooked " << source.string() << " -> " << output.string() << " ("
+                << vk::to_string(format) << ", " << levels << " levels, " << elapsed.count() << " ms)\n";
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            failures++;
+        }
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
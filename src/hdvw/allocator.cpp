@@ -1,8 +1,57 @@
 #include <hdvw/allocator.hpp>
 using namespace hd;
 
+#include <iomanip>
+#include <stdexcept>
+#include <sstream>
+
+const char* hd::toString(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::eBuffer: return "buffer";
+        case MemoryCategory::eImage: return "image";
+        case MemoryCategory::eAttachment: return "attachment";
+        case MemoryCategory::eStaging: return "staging";
+    }
+
+    return "unknown";
+}
+
+static const char* toString(PoolStrategy strategy) {
+    switch (strategy) {
+        case PoolStrategy::eGeneral: return "general";
+        case PoolStrategy::eLinear: return "linear";
+        case PoolStrategy::eBuddy: return "buddy";
+        case PoolStrategy::eDedicated: return "dedicated";
+    }
+
+    return "unknown";
+}
+
+// Escapes a string for a JSON value like VMA's own writer, control characters included
+static std::string escapeJson(const std::string& text) {
+    std::ostringstream out;
+    for (char c : text) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\b': out << "\\b"; break;
+            case '\f': out << "\\f"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                else
+                    out << c;
+        }
+    }
+
+    return out.str();
+}
+
 Allocator_t::Allocator_t(AllocatorCreateInfo ci) {
-    VmaVulkanFunctions funcs;
+    VmaVulkanFunctions funcs = {};
     funcs.vkAllocateMemory = VULKAN_HPP_DEFAULT_DISPATCHER.vkAllocateMemory;
     funcs.vkBindBufferMemory = VULKAN_HPP_DEFAULT_DISPATCHER.vkBindBufferMemory;
     funcs.vkBindImageMemory = VULKAN_HPP_DEFAULT_DISPATCHER.vkBindImageMemory;
@@ -20,7 +69,13 @@ Allocator_t::Allocator_t(AllocatorCreateInfo ci) {
     funcs.vkInvalidateMappedMemoryRanges = VULKAN_HPP_DEFAULT_DISPATCHER.vkInvalidateMappedMemoryRanges;
     funcs.vkMapMemory = VULKAN_HPP_DEFAULT_DISPATCHER.vkMapMemory;
     funcs.vkUnmapMemory = VULKAN_HPP_DEFAULT_DISPATCHER.vkUnmapMemory;
-
+#if VMA_VULKAN_VERSION >= 1001000
+    funcs.vkGetBufferMemoryRequirements2KHR = VULKAN_HPP_DEFAULT_DISPATCHER.vkGetBufferMemoryRequirements2;
+    funcs.vkGetImageMemoryRequirements2KHR = VULKAN_HPP_DEFAULT_DISPATCHER.vkGetImageMemoryRequirements2;
+    funcs.vkBindBufferMemory2KHR = VULKAN_HPP_DEFAULT_DISPATCHER.vkBindBufferMemory2;
+    funcs.vkBindImageMemory2KHR = VULKAN_HPP_DEFAULT_DISPATCHER.vkBindImageMemory2;
+    funcs.vkGetPhysicalDeviceMemoryProperties2KHR = VULKAN_HPP_DEFAULT_DISPATCHER.vkGetPhysicalDeviceMemoryProperties2;
+#endif
 
     VmaAllocatorCreateInfo allocatorInfo = {};
     allocatorInfo.physicalDevice = ci.device->physical();
@@ -28,41 +83,235 @@ Allocator_t::Allocator_t(AllocatorCreateInfo ci) {
     allocatorInfo.instance = ci.instance->raw();
     allocatorInfo.pVulkanFunctions = &funcs;
 
+#if VMA_VULKAN_VERSION >= 1001000
+    // Real heap budgets need VK_EXT_memory_budget and the 1.1 properties2 query
+    if (ci.instance->apiVersion() >= VK_API_VERSION_1_1) {
+        allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_1;
+        if (ci.device->extensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+            allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
+#endif
+
+    _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
+
     if (vmaCreateAllocator(&allocatorInfo, &_allocator) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create the memory allocator");
     }
 }
 
-ReturnImage Allocator_t::create(vk::ImageCreateInfo ici, VmaMemoryUsage flag) {
-    VkImage img;
-    VmaAllocation alloc;
+void Allocator_t::buildPool(Pool& pool) {
+    auto& pi = pool.info;
+
+    VmaAllocationCreateInfo aci = {};
+    aci.usage = pi.memoryUsage;
+
+    VkResult found;
+    if (pi.imageUsage) {
+        vk::ImageCreateInfo ici = {};
+        ici.imageType = vk::ImageType::e2D;
+        ici.extent = vk::Extent3D{ 1, 1, 1 };
+        ici.mipLevels = 1;
+        ici.arrayLayers = 1;
+        ici.format = pi.format;
+        ici.tiling = vk::ImageTiling::eOptimal;
+        ici.usage = pi.imageUsage;
+        ici.samples = vk::SampleCountFlagBits::e1;
+
+        auto c_ici = static_cast<VkImageCreateInfo>(ici);
+        found = vmaFindMemoryTypeIndexForImageInfo(_allocator, &c_ici, &aci, &pool.memoryType);
+    } else {
+        vk::BufferCreateInfo bci = {};
+        bci.size = 1024;
+        bci.usage = pi.bufferUsage;
+
+        auto c_bci = static_cast<VkBufferCreateInfo>(bci);
+        found = vmaFindMemoryTypeIndexForBufferInfo(_allocator, &c_bci, &aci, &pool.memoryType);
+    }
+
+    if (found != VK_SUCCESS)
+        throw std::runtime_error("No memory type fits the pool " + pi.name);
+
+    // Dedicated pools only pin the memory type, every allocation gets its own block
+    if (pi.strategy == PoolStrategy::eDedicated)
+        return;
+
+    VmaPoolCreateInfo vpci = {};
+    vpci.memoryTypeIndex = pool.memoryType;
+    vpci.blockSize = pi.blockSize;
+    vpci.minBlockCount = pi.minBlocks;
+    vpci.maxBlockCount = pi.maxBlocks;
+
+    if (pi.strategy == PoolStrategy::eLinear)
+        vpci.flags |= VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT;
+    if (pi.strategy == PoolStrategy::eBuddy)
+        vpci.flags |= VMA_POOL_CREATE_BUDDY_ALGORITHM_BIT;
+
+    if (vmaCreatePool(_allocator, &vpci, &pool.pool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create the memory pool " + pi.name);
+}
+
+void Allocator_t::createPool(PoolCreateInfo pi) {
+    if (_pools.count(pi.name) > 0)
+        throw std::runtime_error("Memory pool " + pi.name + " already exists");
+
+    Pool pool;
+    pool.info = pi;
+    buildPool(pool);
+
+    _pools[pi.name] = pool;
+}
+
+void Allocator_t::resetPool(const std::string& name) {
+    auto& pool = _pools.at(name);
+
+    // Moves swap the handles behind a record, so movable allocations can't be reset
+    for (auto& [alloc, record] : _records)
+        if (record.pool == &pool && record.owner != nullptr)
+            throw std::runtime_error("Memory pool " + name + " holds movable allocations");
+
+    for (auto iter = _records.begin(); iter != _records.end();) {
+        auto next = std::next(iter);
+        auto alloc = iter->first;
+        auto& record = iter->second;
+
+        if (record.pool == &pool) {
+            if (record.buffer)
+                vmaDestroyBuffer(_allocator, static_cast<VkBuffer>(record.buffer), alloc);
+            else vmaDestroyImage(_allocator, static_cast<VkImage>(record.image), alloc);
+
+            untrack(alloc);
+            pool.allocations--;
+        }
 
+        iter = next;
+    }
+}
+
+void Allocator_t::destroyPool(const std::string& name) {
+    auto& pool = _pools.at(name);
+    if (pool.allocations > 0)
+        throw std::runtime_error("Memory pool " + name + " still has live or pending allocations");
+
+    if (pool.pool != nullptr)
+        vmaDestroyPool(_allocator, pool.pool);
+
+    _pools.erase(name);
+}
+
+bool Allocator_t::hasPool(const std::string& name) {
+    return _pools.count(name) > 0;
+}
+
+uint64_t Allocator_t::poolAllocations(const std::string& name) {
+    return _pools.at(name).allocations;
+}
+
+VmaPoolStats Allocator_t::poolStats(const std::string& name) {
+    VmaPoolStats stats = {};
+
+    auto& pool = _pools.at(name);
+    if (pool.pool != nullptr)
+        vmaGetPoolStats(_allocator, pool.pool, &stats);
+    else stats.allocationCount = pool.allocations;
+
+    return stats;
+}
+
+VmaAllocationCreateInfo Allocator_t::allocationInfo(VmaMemoryUsage usage, VmaAllocationCreateFlags flags, const std::string& pool) {
     VmaAllocationCreateInfo aci = {};
-    aci.usage = flag;
+    aci.usage = usage;
+    aci.flags = flags;
+
+    if (pool.empty())
+        return aci;
+
+    auto iter = _pools.find(pool);
+    if (iter == _pools.end())
+        throw std::runtime_error("Unknown memory pool " + pool);
+
+    if (iter->second.pool != nullptr) {
+        aci.pool = iter->second.pool;
+    } else {
+        aci.memoryTypeBits = 1u << iter->second.memoryType;
+        aci.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    }
+
+    return aci;
+}
+
+uint64_t Allocator_t::track(VmaAllocation alloc, const std::string& pool, MemoryCategory category, vk::Buffer buff, vk::Image img) {
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(_allocator, alloc, &info);
+
+    Record record = { nullptr, category, info.size, ++_nextId, buff, img };
+    if (!pool.empty()) {
+        record.pool = &_pools.at(pool);
+        record.pool->allocations++;
+    }
+
+    auto& stats = _categories[static_cast<size_t>(category)];
+    stats.count++;
+    stats.bytes += info.size;
+
+    _records[alloc] = record;
+    return record.id;
+}
+
+// The pool count is left to release(), VMA still holds the allocation until then
+Allocator_t::Pool* Allocator_t::untrack(VmaAllocation alloc) {
+    auto iter = _records.find(alloc);
+    if (iter == _records.end())
+        return nullptr;
+
+    auto& record = iter->second;
+    auto pool = record.pool;
+
+    auto& stats = _categories[static_cast<size_t>(record.category)];
+    stats.count--;
+    stats.bytes -= record.size;
 
+    _records.erase(iter);
+    return pool;
+}
+
+ReturnImage Allocator_t::create(vk::ImageCreateInfo ici, VmaMemoryUsage flag, const std::string& pool, MemoryCategory category) {
+    VkImage img;
+    VmaAllocation alloc;
+
+    auto aci = allocationInfo(flag, 0, pool);
     auto c_ici = static_cast<VkImageCreateInfo>(ici);
 
     if (vmaCreateImage(_allocator, &c_ici, &aci, &img, &alloc, nullptr) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate an image");
     }
 
-    return { static_cast<vk::Image>(img), alloc };
+    auto id = track(alloc, pool, category, nullptr, static_cast<vk::Image>(img));
+    return { static_cast<vk::Image>(img), alloc, id };
 }
 
-ReturnBuffer Allocator_t::create(vk::BufferCreateInfo ici, VmaMemoryUsage flag) {
+ReturnBuffer Allocator_t::create(vk::BufferCreateInfo ici, VmaMemoryUsage flag, VmaAllocationCreateFlags flags, const std::string& pool,
+        MemoryCategory category) {
     VkBuffer buff;
     VmaAllocation alloc;
+    VmaAllocationInfo info;
 
-    VmaAllocationCreateInfo aci = {};
-    aci.usage = flag;
-
+    auto aci = allocationInfo(flag, flags, pool);
     auto c_ici = static_cast<VkBufferCreateInfo>(ici);
 
-    if (vmaCreateBuffer(_allocator, &c_ici, &aci, &buff, &alloc, nullptr) != VK_SUCCESS) {
+    if (vmaCreateBuffer(_allocator, &c_ici, &aci, &buff, &alloc, &info) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate a buffer");
     }
 
-    return { static_cast<vk::Buffer>(buff), alloc };
+    auto id = track(alloc, pool, category, static_cast<vk::Buffer>(buff), nullptr);
+
+    VkMemoryPropertyFlags memFlags;
+    vmaGetMemoryTypeProperties(_allocator, info.memoryType, &memFlags);
+
+    return {
+        static_cast<vk::Buffer>(buff), alloc, id,
+        info.pMappedData, (memFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0,
+    };
 }
 
 void Allocator_t::map(VmaAllocation alloc, void* &data) {
@@ -73,14 +322,295 @@ void Allocator_t::unmap(VmaAllocation alloc) {
     vmaUnmapMemory(_allocator, alloc);
 }
 
-void Allocator_t::destroy(vk::Image img, VmaAllocation alloc) {
-    vmaDestroyImage(_allocator, static_cast<VkImage>(img), alloc);
+void Allocator_t::flush(VmaAllocation alloc, vk::DeviceSize offset, vk::DeviceSize size) {
+    vmaFlushAllocation(_allocator, alloc, offset, size);
+}
+
+// The memory goes back to VMA once frames in flight are done with it, the statistics
+// drop the allocation right away. A mismatched id means resetPool() got there first,
+// possibly with the VMA handle handed out again since.
+void Allocator_t::destroy(vk::Image img, VmaAllocation alloc, uint64_t id) {
+    auto iter = _records.find(alloc);
+    if (iter == _records.end() || iter->second.id != id)
+        return;
+
+    auto pool = untrack(alloc);
+
+    _deletionQueue->push([this, img, alloc, pool]() {
+            release(nullptr, img, alloc, pool);
+            });
+}
+
+void Allocator_t::destroy(vk::Buffer buff, VmaAllocation alloc, uint64_t id) {
+    auto iter = _records.find(alloc);
+    if (iter == _records.end() || iter->second.id != id)
+        return;
+
+    auto pool = untrack(alloc);
+
+    _deletionQueue->push([this, buff, alloc, pool]() {
+            release(buff, nullptr, alloc, pool);
+            });
+}
+
+void Allocator_t::release(vk::Buffer buff, vk::Image img, VmaAllocation alloc, Pool* pool) {
+    // Allocations handed to VMA's defragmentation can't be freed until it ends
+    if (_defrag != nullptr && _defragSet.count(alloc) > 0) {
+        _deferred.push_back({ buff, img, alloc, pool });
+        return;
+    }
+
+    if (buff)
+        vmaDestroyBuffer(_allocator, static_cast<VkBuffer>(buff), alloc);
+    else vmaDestroyImage(_allocator, static_cast<VkImage>(img), alloc);
+
+    if (pool != nullptr)
+        pool->allocations--;
+}
+
+// VMA refreshes its cached heap budgets when the frame index changes
+void Allocator_t::nextFrame() {
+    vmaSetCurrentFrameIndex(_allocator, ++_frame);
+}
+
+std::vector<HeapBudget> Allocator_t::budgets() {
+    const VkPhysicalDeviceMemoryProperties* props;
+    vmaGetMemoryProperties(_allocator, &props);
+
+    VmaBudget budget[VK_MAX_MEMORY_HEAPS];
+    vmaGetBudget(_allocator, budget);
+
+    std::vector<HeapBudget> heaps(props->memoryHeapCount);
+    for (uint32_t i = 0; i < props->memoryHeapCount; i++) {
+        heaps[i].budget = budget[i].budget;
+        heaps[i].usage = budget[i].usage;
+        heaps[i].blockBytes = budget[i].blockBytes;
+        heaps[i].allocationBytes = budget[i].allocationBytes;
+        heaps[i].deviceLocal = (props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    return heaps;
+}
+
+void Allocator_t::setOwner(VmaAllocation alloc, Movable_t* owner) {
+    auto iter = _records.find(alloc);
+    if (iter != _records.end())
+        iter->second.owner = owner;
+}
+
+// Only allocations with a registered owner take part, everything else stays put.
+// Moves are always done by GPU copies so that source and destination never overlap.
+bool Allocator_t::beginDefragmentation(DefragmentationInfo di) {
+    if (_defrag != nullptr)
+        return true;
+
+    std::vector<VmaAllocation> allocations;
+    for (auto& [alloc, record] : _records)
+        if (record.owner != nullptr)
+            allocations.push_back(alloc);
+
+    if (allocations.empty())
+        return false;
+
+    VmaDefragmentationInfo2 info = {};
+    info.flags = VMA_DEFRAGMENTATION_FLAG_INCREMENTAL;
+    info.allocationCount = static_cast<uint32_t>(allocations.size());
+    info.pAllocations = allocations.data();
+    info.maxCpuBytesToMove = 0;
+    info.maxCpuAllocationsToMove = 0;
+    info.maxGpuBytesToMove = di.maxBytes;
+    info.maxGpuAllocationsToMove = UINT32_MAX;
+
+    auto result = vmaDefragmentationBegin(_allocator, &info, nullptr, &_defrag);
+    if (result != VK_NOT_READY) {
+        _defrag = nullptr;
+        return false;
+    }
+
+    _defragInfo = di;
+    _defragSet = std::unordered_set<VmaAllocation>(allocations.begin(), allocations.end());
+    _defragSteps = 0;
+    return true;
+}
+
+// Call once per frame with a command buffer that is submitted before anything reads
+// the moved resources. A pass is committed framesInFlight steps after its copies were
+// recorded, so the old locations are no longer in use when VMA releases them.
+bool Allocator_t::defragmentStep(vk::CommandBuffer cmd) {
+    if (_defrag == nullptr)
+        return false;
+
+    _defragSteps++;
+
+    if (!_moved.empty()) {
+        if (_defragSteps < _passStep + _defragInfo.framesInFlight)
+            return true;
+
+        for (auto& alloc : _moved) {
+            auto iter = _records.find(alloc);
+            if (iter != _records.end() && iter->second.owner != nullptr)
+                iter->second.owner->retire(_device);
+        }
+        _moved.clear();
+
+        if (vmaEndDefragmentationPass(_allocator, _defrag) == VK_SUCCESS) {
+            finishDefragmentation();
+            return false;
+        }
+    }
+
+    std::vector<VmaDefragmentationPassMoveInfo> moves(_defragInfo.maxMovesPerFrame);
+    VmaDefragmentationPassInfo pass = {};
+    pass.moveCount = static_cast<uint32_t>(moves.size());
+    pass.pMoves = moves.data();
+
+    vmaBeginDefragmentationPass(_allocator, _defrag, &pass);
+
+    if (pass.moveCount == 0) {
+        vmaEndDefragmentationPass(_allocator, _defrag);
+        finishDefragmentation();
+        return false;
+    }
+
+    vk::MemoryBarrier before = {};
+    before.srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+    before.dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer,
+            vk::DependencyFlags{0}, before, nullptr, nullptr);
+
+    for (uint32_t i = 0; i < pass.moveCount; i++) {
+        auto& move = moves[i];
+
+        // A missing owner means the allocation is already queued for destruction
+        auto iter = _records.find(move.allocation);
+        if (iter != _records.end() && iter->second.owner != nullptr)
+            iter->second.owner->relocate({ _device, cmd, move.memory, move.offset });
+
+        _moved.push_back(move.allocation);
+    }
+
+    vk::MemoryBarrier after = {};
+    after.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    after.dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite;
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+            vk::DependencyFlags{0}, after, nullptr, nullptr);
+
+    _passStep = _defragSteps;
+    return true;
+}
+
+// Stops early, the device has to be idle
+void Allocator_t::endDefragmentation() {
+    if (_defrag == nullptr)
+        return;
+
+    for (auto& alloc : _moved) {
+        auto iter = _records.find(alloc);
+        if (iter != _records.end() && iter->second.owner != nullptr)
+            iter->second.owner->retire(_device);
+    }
+
+    if (!_moved.empty())
+        vmaEndDefragmentationPass(_allocator, _defrag);
+    _moved.clear();
+
+    finishDefragmentation();
+}
+
+bool Allocator_t::defragmenting() {
+    return _defrag != nullptr;
+}
+
+vk::Device Allocator_t::device() {
+    return _device;
+}
+
+DeletionQueue Allocator_t::deletionQueue() {
+    return _deletionQueue;
 }
 
-void Allocator_t::destroy(vk::Buffer buff, VmaAllocation alloc) {
-    vmaDestroyBuffer(_allocator, static_cast<VkBuffer>(buff), alloc);
+void Allocator_t::finishDefragmentation() {
+    vmaDefragmentationEnd(_allocator, _defrag);
+    _defrag = nullptr;
+    _defragSet.clear();
+
+    for (auto& deferred : _deferred) {
+        if (deferred.buffer)
+            vmaDestroyBuffer(_allocator, static_cast<VkBuffer>(deferred.buffer), deferred.allocation);
+        else vmaDestroyImage(_allocator, static_cast<VkImage>(deferred.image), deferred.allocation);
+
+        if (deferred.pool != nullptr)
+            deferred.pool->allocations--;
+    }
+    _deferred.clear();
+}
+
+CategoryStats Allocator_t::categoryStats(MemoryCategory category) {
+    return _categories[static_cast<size_t>(category)];
+}
+
+uint64_t Allocator_t::liveAllocations() {
+    return _records.size();
+}
+
+std::string Allocator_t::statsJson(bool detailed) {
+    std::ostringstream out;
+
+    out << "{\"frame\": " << _frame << ", \"liveAllocations\": " << _records.size();
+
+    out << ", \"heaps\": [";
+    auto heaps = budgets();
+    for (size_t i = 0; i < heaps.size(); i++) {
+        out << (i ? ", " : "") << "{\"heap\": " << i
+            << ", \"deviceLocal\": " << (heaps[i].deviceLocal ? "true" : "false")
+            << ", \"budget\": " << heaps[i].budget
+            << ", \"usage\": " << heaps[i].usage
+            << ", \"blockBytes\": " << heaps[i].blockBytes
+            << ", \"allocationBytes\": " << heaps[i].allocationBytes << "}";
+    }
+    out << "]";
+
+    out << ", \"categories\": {";
+    for (size_t i = 0; i < _categories.size(); i++) {
+        out << (i ? ", " : "") << "\"" << toString(static_cast<MemoryCategory>(i)) << "\": {"
+            << "\"count\": " << _categories[i].count
+            << ", \"bytes\": " << _categories[i].bytes << "}";
+    }
+    out << "}";
+
+    out << ", \"pools\": {";
+    bool first = true;
+    for (auto& [name, pool] : _pools) {
+        auto stats = poolStats(name);
+        out << (first ? "" : ", ") << "\"" << escapeJson(name) << "\": {"
+            << "\"strategy\": \"" << ::toString(pool.info.strategy) << "\""
+            << ", \"memoryType\": " << pool.memoryType
+            << ", \"allocations\": " << pool.allocations
+            << ", \"size\": " << stats.size
+            << ", \"unused\": " << stats.unusedSize
+            << ", \"blocks\": " << stats.blockCount << "}";
+        first = false;
+    }
+    out << "}";
+
+    char* vma;
+    vmaBuildStatsString(_allocator, &vma, detailed ? VK_TRUE : VK_FALSE);
+    out << ", \"vma\": " << vma;
+    vmaFreeStatsString(_allocator, vma);
+
+    out << "}";
+    return out.str();
 }
 
 Allocator_t::~Allocator_t() {
+    // Pending deleters call back into this allocator
+    _device.waitIdle();
+    _deletionQueue->flush();
+    endDefragmentation();
+
+    for (auto& [name, pool] : _pools)
+        if (pool.pool != nullptr)
+            vmaDestroyPool(_allocator, pool.pool);
+
     vmaDestroyAllocator(_allocator);
 }
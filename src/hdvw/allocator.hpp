@@ -8,6 +8,11 @@
 #include <hdvw/device.hpp>
 
 #include <memory>
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace hd {
     struct AllocatorCreateInfo {
@@ -15,14 +20,86 @@ namespace hd {
         Device device;
     };
 
+    enum class MemoryCategory {
+        eBuffer,
+        eImage,
+        eAttachment,
+        eStaging,
+    };
+
+    const char* toString(MemoryCategory category);
+
+    struct HeapBudget {
+        vk::DeviceSize budget;
+        vk::DeviceSize usage;
+        vk::DeviceSize blockBytes;
+        vk::DeviceSize allocationBytes;
+        bool deviceLocal;
+    };
+
+    struct CategoryStats {
+        uint64_t count = 0;
+        vk::DeviceSize bytes = 0;
+    };
+
+    enum class PoolStrategy {
+        eGeneral,
+        eLinear,
+        eBuddy,
+        eDedicated,
+    };
+
+    // Either bufferUsage or imageUsage describes what the pool will hold, which picks its memory type
+    struct PoolCreateInfo {
+        std::string name;
+        PoolStrategy strategy = PoolStrategy::eGeneral;
+        VmaMemoryUsage memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY;
+        vk::BufferUsageFlags bufferUsage = {};
+        vk::ImageUsageFlags imageUsage = {};
+        vk::Format format = vk::Format::eR8G8B8A8Unorm;
+        vk::DeviceSize blockSize = 0;
+        size_t minBlocks = 0;
+        size_t maxBlocks = 0;
+    };
+
+    struct DefragmentationInfo {
+        vk::DeviceSize maxBytes = VK_WHOLE_SIZE;
+        uint32_t maxMovesPerFrame = 16;
+        uint32_t framesInFlight = 3;
+    };
+
+    struct Relocation {
+        vk::Device device;
+        vk::CommandBuffer commandBuffer;
+        vk::DeviceMemory memory;
+        vk::DeviceSize offset;
+    };
+
+    // Implemented by wrappers whose allocation may be moved by defragmentation. relocate()
+    // binds a new handle at the destination and records the copy, retire() destroys the
+    // old handle once no frame in flight can reference it.
+    class Movable_t {
+        public:
+            virtual void relocate(Relocation relocation) = 0;
+
+            virtual void retire(vk::Device device) = 0;
+
+            virtual ~Movable_t() = default;
+    };
+
+    // The id tells destroy() whether resetPool() has already freed the allocation
     struct ReturnImage {
         vk::Image image;
         VmaAllocation allocation;
+        uint64_t id;
     };
 
     struct ReturnBuffer {
         vk::Buffer buffer;
         VmaAllocation allocation;
+        uint64_t id;
+        void* mapped = nullptr;
+        bool coherent = true;
     };
 
     class Allocator_t;
@@ -30,7 +107,60 @@ namespace hd {
 
     class Allocator_t {
         private:
+            struct Pool {
+                PoolCreateInfo info;
+                VmaPool pool = nullptr;
+                uint32_t memoryType = 0;
+                // Counts allocations until VMA has freed them, not until their handles drop
+                uint64_t allocations = 0;
+            };
+
+            struct Record {
+                Pool* pool;
+                MemoryCategory category;
+                vk::DeviceSize size;
+                uint64_t id;
+                vk::Buffer buffer;
+                vk::Image image;
+                Movable_t* owner = nullptr;
+            };
+
+            struct Deferred {
+                vk::Buffer buffer;
+                vk::Image image;
+                VmaAllocation allocation;
+                Pool* pool;
+            };
+
             VmaAllocator _allocator;
+            vk::Device _device;
+            DeletionQueue _deletionQueue;
+            uint32_t _frame = 0;
+            uint64_t _nextId = 0;
+
+            VmaDefragmentationContext _defrag = nullptr;
+            DefragmentationInfo _defragInfo;
+            std::unordered_set<VmaAllocation> _defragSet;
+            std::vector<VmaAllocation> _moved;
+            std::vector<Deferred> _deferred;
+            uint64_t _defragSteps = 0;
+            uint64_t _passStep = 0;
+
+            void finishDefragmentation();
+
+            void release(vk::Buffer buff, vk::Image img, VmaAllocation alloc, Pool* pool);
+
+            std::unordered_map<std::string, Pool> _pools;
+            std::unordered_map<VmaAllocation, Record> _records;
+            std::array<CategoryStats, 4> _categories = {};
+
+            VmaAllocationCreateInfo allocationInfo(VmaMemoryUsage usage, VmaAllocationCreateFlags flags, const std::string& pool);
+
+            uint64_t track(VmaAllocation alloc, const std::string& pool, MemoryCategory category, vk::Buffer buff, vk::Image img);
+
+            Pool* untrack(VmaAllocation alloc);
+
+            void buildPool(Pool& pool);
 
         public:
             static Allocator conjure(AllocatorCreateInfo ci) {
@@ -39,17 +169,60 @@ namespace hd {
 
             Allocator_t(AllocatorCreateInfo ci);
 
-            ReturnImage create(vk::ImageCreateInfo ici, VmaMemoryUsage flag);
+            void createPool(PoolCreateInfo pi);
+
+            // Frees every allocation left in the pool at once, a linear pool then starts over
+            // from the front and keeps its blocks. Frames in flight must be done with them,
+            // and their wrappers may only be destroyed afterwards.
+            void resetPool(const std::string& name);
 
-            ReturnBuffer create(vk::BufferCreateInfo ici, VmaMemoryUsage flag);
+            void destroyPool(const std::string& name);
+
+            bool hasPool(const std::string& name);
+
+            uint64_t poolAllocations(const std::string& name);
+
+            VmaPoolStats poolStats(const std::string& name);
+
+            ReturnImage create(vk::ImageCreateInfo ici, VmaMemoryUsage flag, const std::string& pool = "",
+                    MemoryCategory category = MemoryCategory::eImage);
+
+            ReturnBuffer create(vk::BufferCreateInfo ici, VmaMemoryUsage flag, VmaAllocationCreateFlags flags = 0, const std::string& pool = "",
+                    MemoryCategory category = MemoryCategory::eBuffer);
 
             void map(VmaAllocation alloc, void* &data);
 
             void unmap(VmaAllocation alloc);
 
-            void destroy(vk::Image img, VmaAllocation alloc);
+            void flush(VmaAllocation alloc, vk::DeviceSize offset, vk::DeviceSize size);
+
+            void destroy(vk::Image img, VmaAllocation alloc, uint64_t id);
+
+            void destroy(vk::Buffer buff, VmaAllocation alloc, uint64_t id);
+
+            void nextFrame();
+
+            void setOwner(VmaAllocation alloc, Movable_t* owner);
+
+            bool beginDefragmentation(DefragmentationInfo di = {});
+
+            bool defragmentStep(vk::CommandBuffer cmd);
+
+            void endDefragmentation();
+
+            bool defragmenting();
+
+            vk::Device device();
+
+            DeletionQueue deletionQueue();
+
+            std::vector<HeapBudget> budgets();
+
+            CategoryStats categoryStats(MemoryCategory category);
+
+            uint64_t liveAllocations();
 
-            void destroy(vk::Buffer buff, VmaAllocation alloc);
+            std::string statsJson(bool detailed = false);
 
             ~Allocator_t();
     };
@@ -11,7 +11,9 @@ Attachment_t::Attachment_t(AttachmentCreateInfo ci) {
                 .format = ci.format,
                 .aspect = ci.aspect,
                 .imageUsage = ci.usage,
-                .memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+                .memoryUsage = ci.memoryUsage,
+                .pool = ci.pool,
+                .category = MemoryCategory::eAttachment,
                 });
         _imageHandle = _image->raw();
 
@@ -9,6 +9,7 @@
 #include <hdvw/image.hpp>
 
 #include <memory>
+#include <string>
 
 namespace hd {
     struct AttachmentCreateInfo {
@@ -19,6 +20,8 @@ namespace hd {
         vk::ImageUsageFlags usage;
         vk::ImageAspectFlags aspect;
         vk::Extent2D extent;
+        std::string pool = "";
+        VmaMemoryUsage memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY;
     };
 
     class Attachment_t;
@@ -0,0 +1,60 @@
+#include <hdvw/boxfilter.hpp>
+using namespace hd;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+static float srgbToLinear(uint8_t value) {
+    float c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t linearToSrgb(float value) {
+    float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+std::vector<uint8_t> hd::downsampleSrgba8(const uint8_t* src, vk::Extent2D srcExtent, vk::Extent2D dstExtent) {
+    static const std::array<float, 256> toLinear = [] {
+        std::array<float, 256> table;
+        for (int iter = 0; iter < 256; iter++)
+            table[iter] = srgbToLinear(iter);
+        return table;
+    }();
+
+    std::vector<uint8_t> dst(dstExtent.width * dstExtent.height * 4);
+
+    #pragma omp parallel for
+    for (uint32_t y = 0; y < dstExtent.height; y++) {
+        uint32_t y0 = std::min(y * 2, srcExtent.height - 1);
+        uint32_t y1 = std::min(y * 2 + 1, srcExtent.height - 1);
+
+        for (uint32_t x = 0; x < dstExtent.width; x++) {
+            uint32_t x0 = std::min(x * 2, srcExtent.width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, srcExtent.width - 1);
+
+            const uint8_t* texels[4] = {
+                src + (y0 * srcExtent.width + x0) * 4,
+                src + (y0 * srcExtent.width + x1) * 4,
+                src + (y1 * srcExtent.width + x0) * 4,
+                src + (y1 * srcExtent.width + x1) * 4,
+            };
+
+            uint8_t* out = dst.data() + (y * dstExtent.width + x) * 4;
+            for (int channel = 0; channel < 3; channel++) {
+                float sum = 0.0f;
+                for (auto texel: texels)
+                    sum += toLinear[texel[channel]];
+                out[channel] = linearToSrgb(sum / 4.0f);
+            }
+
+            uint32_t alpha = 0;
+            for (auto texel: texels)
+                alpha += texel[3];
+            out[3] = static_cast<uint8_t>((alpha + 2) / 4);
+        }
+    }
+
+    return dst;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace hd {
+    // 2x2 box filter for RGBA8 sRGB, colour is averaged in linear space and alpha as is.
+    // Odd edges reuse the last row or column.
+    std::vector<uint8_t> downsampleSrgba8(const uint8_t* src, vk::Extent2D srcExtent, vk::Extent2D dstExtent);
+}
@@ -1,6 +1,9 @@
 #include <hdvw/buffer.hpp>
 using namespace hd;
 
+#include <set>
+#include <stdexcept>
+
 Buffer_t::Buffer_t(BufferCreateInfo ci) {
     _allocator = ci.allocator;
     _bufferSize = ci.size;
@@ -10,9 +13,34 @@ Buffer_t::Buffer_t(BufferCreateInfo ci) {
     bi.usage = ci.bufferUsage;
     bi.sharingMode = vk::SharingMode::eExclusive;
 
-    auto result = _allocator->create(bi, ci.memoryUsage);
+    std::set<uint32_t> families(ci.queueFamilies.begin(), ci.queueFamilies.end());
+    _families = std::vector<uint32_t>(families.begin(), families.end());
+    if (_families.size() > 1) {
+        bi.sharingMode = vk::SharingMode::eConcurrent;
+        bi.queueFamilyIndexCount = _families.size();
+        bi.pQueueFamilyIndices = _families.data();
+        _concurrent = true;
+    }
+    _info = bi;
+
+    VmaAllocationCreateFlags flags = 0;
+    if (ci.mapped)
+        flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    auto result = _allocator->create(bi, ci.memoryUsage, flags, ci.pool, ci.category);
     _buffer = result.buffer;
     _bufferMemory = result.allocation;
+    _allocationId = result.id;
+    _mapped = result.mapped;
+    _coherent = result.coherent;
+
+    if (ci.movable) {
+        auto transfer = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+        // A move would invalidate the mapped pointer
+        if ((ci.bufferUsage & transfer) != transfer || ci.mapped)
+            throw std::invalid_argument("Only unmapped buffers with transfer usage can be movable");
+        _allocator->setOwner(_bufferMemory, this);
+    }
 }
 
 vk::DeviceSize Buffer_t::size() {
@@ -23,10 +51,48 @@ VmaAllocation Buffer_t::memory() {
     return _bufferMemory;
 }
 
+void* Buffer_t::data() {
+    return _mapped;
+}
+
+void Buffer_t::flush(vk::DeviceSize offset, vk::DeviceSize size) {
+    if (!_coherent)
+        _allocator->flush(_bufferMemory, offset, size);
+}
+
+bool Buffer_t::concurrent() {
+    return _concurrent;
+}
+
+uint64_t Buffer_t::generation() {
+    return _generation;
+}
+
+void Buffer_t::relocate(Relocation relocation) {
+    auto buffer = relocation.device.createBuffer(_info);
+    relocation.device.bindBufferMemory(buffer, relocation.memory, relocation.offset);
+
+    vk::BufferCopy region = {};
+    region.size = _bufferSize;
+    relocation.commandBuffer.copyBuffer(_buffer, buffer, region);
+
+    _retired.push_back(_buffer);
+    _buffer = buffer;
+    _generation++;
+}
+
+void Buffer_t::retire(vk::Device device) {
+    for (auto& buffer : _retired)
+        device.destroy(buffer);
+    _retired.clear();
+}
+
 vk::Buffer Buffer_t::raw() {
     return _buffer;
 }
 
 Buffer_t::~Buffer_t() {
-    _allocator->destroy(_buffer, _bufferMemory);
+    for (auto& buffer : _retired)
+        _allocator->deletionQueue()->destroy(_allocator->device(), buffer);
+    _allocator->destroy(_buffer, _bufferMemory, _allocationId);
 }
@@ -5,6 +5,9 @@
 #include <hdvw/allocator.hpp>
 
 #include <memory>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace hd {
     struct BufferCreateInfo {
@@ -12,19 +15,35 @@ namespace hd {
         vk::DeviceSize size;
         vk::BufferUsageFlags bufferUsage;
         VmaMemoryUsage memoryUsage;
+        bool mapped = false;
+        std::vector<uint32_t> queueFamilies = {};
+        std::string pool = "";
+        MemoryCategory category = MemoryCategory::eBuffer;
+        // Lets defragmentation move the buffer, needs transfer source and destination usage.
+        // Whoever holds descriptors of it has to follow generation().
+        bool movable = false;
     };
 
     class Buffer_t;
     typedef std::shared_ptr<Buffer_t> Buffer;
 
-    class Buffer_t {
+    class Buffer_t : public Movable_t {
         private:
             vk::Buffer _buffer;
             VmaAllocation _bufferMemory;
+            uint64_t _allocationId;
+            vk::BufferCreateInfo _info;
+            std::vector<uint32_t> _families;
+            std::vector<vk::Buffer> _retired;
+            uint64_t _generation = 0;
 
             vk::DeviceSize _bufferSize;
             Allocator _allocator;
 
+            void* _mapped = nullptr;
+            bool _coherent = true;
+            bool _concurrent = false;
+
         public:
             static Buffer conjure(BufferCreateInfo ci) {
                 return std::make_shared<Buffer_t>(ci);
@@ -36,6 +55,23 @@ namespace hd {
 
             VmaAllocation memory();
 
+            void* data();
+
+            template<class T>
+            std::span<T> span() {
+                return std::span<T>(static_cast<T*>(_mapped), _mapped == nullptr ? 0 : _bufferSize / sizeof(T));
+            }
+
+            void flush(vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+
+            bool concurrent();
+
+            uint64_t generation();
+
+            void relocate(Relocation relocation) override;
+
+            void retire(vk::Device device) override;
+
             vk::Buffer raw();
 
             ~Buffer_t();
@@ -1,6 +1,9 @@
 #include <hdvw/commandbuffer.hpp>
 using namespace hd;
 
+#include <stdexcept>
+#include <vector>
+
 CommandBuffer_t::CommandBuffer_t(CommandBufferCreateInfo ci) {
     _device = ci.device;
     _buffer = ci.commandBuffer;
@@ -19,54 +22,162 @@ void CommandBuffer_t::barrier(BarrierCreateInfo ci) {
             );
 }
 
-void CommandBuffer_t::transitionImageLayout(TransitionImageLayoutInfo ci) {
-    vk::ImageMemoryBarrier barrier = {};
-    barrier.oldLayout = ci.image->layout();
-    barrier.newLayout = ci.layout;
+void CommandBuffer_t::barrier(BufferBarrierInfo bi) {
+    vk::BufferMemoryBarrier barrier = {};
+    barrier.srcAccessMask = bi.srcAccess;
+    barrier.dstAccessMask = bi.dstAccess;
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = ci.image->raw();
-    barrier.subresourceRange = ci.image->range();
+    barrier.buffer = bi.buffer->raw();
+    barrier.offset = bi.offset;
+    barrier.size = bi.size;
+
+    _buffer.pipelineBarrier(
+            bi.srcStage, bi.dstStage, vk::DependencyFlags{0},
+            nullptr, barrier, nullptr
+            );
+}
+
+// One barrier per level, so levels in different layouts stay where they are
+void CommandBuffer_t::barrier(ImageBarrierInfo bi) {
+    std::vector<vk::ImageMemoryBarrier> barriers;
+    for (uint32_t level = 0; level < bi.image->mipLevels(); level++) {
+        vk::ImageMemoryBarrier barrier = {};
+        barrier.srcAccessMask = bi.srcAccess;
+        barrier.dstAccessMask = bi.dstAccess;
+        barrier.oldLayout = bi.image->layout(level);
+        barrier.newLayout = bi.image->layout(level);
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = bi.image->raw();
+        barrier.subresourceRange = bi.image->range();
+        barrier.subresourceRange.baseMipLevel = level;
+        barrier.subresourceRange.levelCount = 1;
+        barriers.push_back(barrier);
+    }
+
+    _buffer.pipelineBarrier(
+            bi.srcStage, bi.dstStage, vk::DependencyFlags{0},
+            nullptr, nullptr, barriers
+            );
+}
+
+struct TransitionMasks {
+    vk::AccessFlags srcAccess;
+    vk::AccessFlags dstAccess;
+    vk::PipelineStageFlags srcStage;
+    vk::PipelineStageFlags dstStage;
+};
+
+static TransitionMasks transitionMasks(vk::ImageLayout from, vk::ImageLayout to) {
+    using Layout = vk::ImageLayout;
+    using Access = vk::AccessFlagBits;
+    using Stage = vk::PipelineStageFlagBits;
+
+    if (from == Layout::eUndefined && to == Layout::eTransferDstOptimal)
+        return { vk::AccessFlags{0}, Access::eTransferWrite, Stage::eTopOfPipe, Stage::eTransfer };
+    if (from == Layout::eUndefined && to == Layout::eGeneral)
+        return { vk::AccessFlags{0}, vk::AccessFlags{0}, Stage::eTopOfPipe, Stage::eTopOfPipe };
+    if (from == Layout::eTransferDstOptimal && to == Layout::eGeneral)
+        return { Access::eTransferWrite, vk::AccessFlags{0}, Stage::eTransfer, Stage::eTopOfPipe };
+    if (from == Layout::eTransferDstOptimal && to == Layout::eTransferSrcOptimal)
+        return { Access::eTransferWrite, Access::eTransferRead, Stage::eTransfer, Stage::eTransfer };
+    if (from == Layout::eTransferDstOptimal && to == Layout::eShaderReadOnlyOptimal)
+        return { Access::eTransferWrite, Access::eShaderRead, Stage::eTransfer, Stage::eFragmentShader };
+    if (from == Layout::eTransferSrcOptimal && to == Layout::eShaderReadOnlyOptimal)
+        return { Access::eTransferRead, Access::eShaderRead, Stage::eTransfer, Stage::eFragmentShader };
+    if (from == Layout::eTransferSrcOptimal && to == Layout::eTransferDstOptimal)
+        return { Access::eTransferRead, Access::eTransferWrite, Stage::eTransfer, Stage::eTransfer };
+    if (from == Layout::eShaderReadOnlyOptimal && to == Layout::eTransferDstOptimal)
+        return { Access::eShaderRead, Access::eTransferWrite, Stage::eFragmentShader, Stage::eTransfer };
+    // Storage images are written by compute and may be sampled by any shader stage
+    vk::PipelineStageFlags readers = Stage::eVertexShader | Stage::eFragmentShader | Stage::eComputeShader;
+    if (from == Layout::eGeneral && to == Layout::eShaderReadOnlyOptimal)
+        return { Access::eShaderWrite, Access::eShaderRead, Stage::eComputeShader, readers };
+    if (from == Layout::eShaderReadOnlyOptimal && to == Layout::eGeneral)
+        return { Access::eShaderRead, Access::eShaderWrite, readers, Stage::eComputeShader };
+
+    throw std::invalid_argument("unsupported layout transition!");
+}
+
+// Levels of the range that sit in different layouts get a barrier each, levels
+// already in the target layout are skipped.
+void CommandBuffer_t::transitionImageLayout(TransitionImageLayoutInfo ci) {
+    uint32_t end = ci.levelCount == VK_REMAINING_MIP_LEVELS
+        ? ci.image->mipLevels() : ci.baseMipLevel + ci.levelCount;
 
+    std::vector<vk::ImageMemoryBarrier> barriers;
     vk::PipelineStageFlags sourceStage;
     vk::PipelineStageFlags destinationStage;
 
-    if (ci.image->layout() == vk::ImageLayout::eUndefined && ci.layout == vk::ImageLayout::eTransferDstOptimal) {
-        barrier.srcAccessMask = vk::AccessFlags{0};
-        barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-        sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
-        destinationStage = vk::PipelineStageFlagBits::eTransfer;
-    } else if (ci.image->layout() == vk::ImageLayout::eUndefined && ci.layout == vk::ImageLayout::eGeneral) {
-        barrier.srcAccessMask = vk::AccessFlags{0};
-        barrier.dstAccessMask = vk::AccessFlags{0};
-
-        sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
-        destinationStage = vk::PipelineStageFlagBits::eTopOfPipe;
-    } else if (ci.image->layout() == vk::ImageLayout::eTransferDstOptimal && ci.layout == vk::ImageLayout::eGeneral) {
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlags{0};
-
-        sourceStage = vk::PipelineStageFlagBits::eTransfer;
-        destinationStage = vk::PipelineStageFlagBits::eTopOfPipe;
-    } else if (ci.image->layout() == vk::ImageLayout::eTransferDstOptimal && ci.layout == vk::ImageLayout::eTransferSrcOptimal) {
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-
-        sourceStage = vk::PipelineStageFlagBits::eTransfer;
-        destinationStage = vk::PipelineStageFlagBits::eTransfer;
-    } else if (ci.image->layout() == vk::ImageLayout::eTransferDstOptimal && ci.layout == vk::ImageLayout::eShaderReadOnlyOptimal) {
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-        sourceStage = vk::PipelineStageFlagBits::eTransfer;
-        destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
-    } else {
-        throw std::invalid_argument("unsupported layout transition!");
+    uint32_t level = ci.baseMipLevel;
+    while (level < end) {
+        auto layout = ci.image->layout(level);
+
+        uint32_t runEnd = level + 1;
+        while (runEnd < end && ci.image->layout(runEnd) == layout)
+            runEnd++;
+
+        if (layout != ci.layout) {
+            auto masks = transitionMasks(layout, ci.layout);
+
+            vk::ImageMemoryBarrier barrier = {};
+            barrier.oldLayout = layout;
+            barrier.newLayout = ci.layout;
+            barrier.srcAccessMask = masks.srcAccess;
+            barrier.dstAccessMask = masks.dstAccess;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = ci.image->raw();
+            barrier.subresourceRange = ci.image->range();
+            barrier.subresourceRange.baseMipLevel = level;
+            barrier.subresourceRange.levelCount = runEnd - level;
+            barriers.push_back(barrier);
+
+            sourceStage |= masks.srcStage;
+            destinationStage |= masks.dstStage;
+        }
+
+        level = runEnd;
+    }
+
+    if (barriers.empty())
+        return;
+
+    _buffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags{0}, nullptr, nullptr, barriers);
+    ci.image->setLayout(ci.layout, ci.baseMipLevel, end - ci.baseMipLevel);
+}
+
+void CommandBuffer_t::generateMips(GenerateMipsInfo ci) {
+    auto image = ci.image;
+    auto range = image->range();
+
+    for (uint32_t level = 1; level < image->mipLevels(); level++) {
+        transitionImageLayout({
+                .image = image,
+                .layout = vk::ImageLayout::eTransferSrcOptimal,
+                .baseMipLevel = level - 1,
+                .levelCount = 1,
+                });
+
+        auto src = image->extent(level - 1);
+        auto dst = image->extent(level);
+
+        vk::ImageBlit blit = {};
+        blit.srcSubresource = vk::ImageSubresourceLayers(range.aspectMask, level - 1, 0, range.layerCount);
+        blit.srcOffsets[1] = vk::Offset3D{ (int32_t) src.width, (int32_t) src.height, 1 };
+        blit.dstSubresource = vk::ImageSubresourceLayers(range.aspectMask, level, 0, range.layerCount);
+        blit.dstOffsets[1] = vk::Offset3D{ (int32_t) dst.width, (int32_t) dst.height, 1 };
+
+        _buffer.blitImage(image->raw(), vk::ImageLayout::eTransferSrcOptimal,
+                image->raw(), vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
     }
 
-    _buffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags{0}, nullptr, nullptr, barrier);
-    ci.image->setLayout(ci.layout);
+    // Every level but the last was read from, one transition covers both layouts
+    transitionImageLayout({
+            .image = image,
+            .layout = ci.layout,
+            });
 }
 
 void CommandBuffer_t::begin() {
@@ -105,19 +216,21 @@ void CommandBuffer_t::copy(CopyBufferToBufferInfo ci) {
 
 void CommandBuffer_t::copy(CopyBufferToImageInfo ci) {
     vk::BufferImageCopy region = {};
-    region.bufferOffset = 0;
+    region.bufferOffset = ci.bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
 
     region.imageSubresource.aspectMask = ci.image->range().aspectMask;
-    region.imageSubresource.mipLevel = ci.image->range().baseMipLevel;
-    region.imageSubresource.baseArrayLayer = ci.image->range().baseArrayLayer;
-    region.imageSubresource.layerCount = ci.image->range().layerCount;
+    region.imageSubresource.mipLevel = ci.mipLevel;
+    region.imageSubresource.baseArrayLayer = ci.arrayLayer;
+    region.imageSubresource.layerCount = 1;
 
-    region.imageOffset = vk::Offset3D{0, 0, 0};
-    region.imageExtent = vk::Extent3D{ci.image->extent().width, ci.image->extent().height, 1};
+    region.imageOffset = ci.imageOffset;
+    if (ci.imageExtent.width == 0)
+        region.imageExtent = vk::Extent3D{ci.image->extent(ci.mipLevel).width, ci.image->extent(ci.mipLevel).height, 1};
+    else region.imageExtent = ci.imageExtent;
 
-    _buffer.copyBufferToImage(ci.buffer->raw(), ci.image->raw(), ci.image->layout(), region);
+    _buffer.copyBufferToImage(ci.buffer->raw(), ci.image->raw(), ci.image->layout(ci.mipLevel), region);
 }
 
 void CommandBuffer_t::beginRenderPass(RenderPassBeginInfo bi) {
@@ -141,6 +254,33 @@ void CommandBuffer_t::endRenderPass(CommandBuffer buffer) {
     buffer->raw().endRenderPass();
 }
 
+void CommandBuffer_t::setViewport(vk::Extent2D extent) {
+    vk::Viewport viewport = {};
+    viewport.width = extent.width;
+    viewport.height = extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    _buffer.setViewport(0, viewport);
+    _buffer.setScissor(0, vk::Rect2D{ { 0, 0 }, extent });
+}
+
+void CommandBuffer_t::setDynamicState(DynamicStateInfo di) {
+    _buffer.setCullModeEXT(di.cullMode);
+    _buffer.setFrontFaceEXT(di.frontFace);
+    _buffer.setDepthTestEnableEXT(di.depthTest);
+    _buffer.setDepthWriteEnableEXT(di.depthWrite);
+    _buffer.setPrimitiveTopologyEXT(di.topology);
+}
+
+void CommandBuffer_t::dispatch(uint32_t x, uint32_t y, uint32_t z) {
+    _buffer.dispatch(x, y, z);
+}
+
+void CommandBuffer_t::dispatchIndirect(Buffer buffer, vk::DeviceSize offset) {
+    _buffer.dispatchIndirect(buffer->raw(), offset);
+}
+
 vk::CommandBuffer CommandBuffer_t::raw() {
     return _buffer;
 }
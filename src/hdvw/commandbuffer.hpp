@@ -23,6 +23,26 @@ namespace hd {
         vk::PipelineStageFlags dstStage;
     };
 
+    // Defaults order a compute shader's writes before the next dispatch reads them
+    struct BufferBarrierInfo {
+        Buffer buffer;
+        vk::AccessFlags srcAccess = vk::AccessFlagBits::eShaderWrite;
+        vk::AccessFlags dstAccess = vk::AccessFlagBits::eShaderRead;
+        vk::PipelineStageFlags srcStage = vk::PipelineStageFlagBits::eComputeShader;
+        vk::PipelineStageFlags dstStage = vk::PipelineStageFlagBits::eComputeShader;
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = VK_WHOLE_SIZE;
+    };
+
+    // Keeps every level in the layout it is in, use transitionImageLayout to change it
+    struct ImageBarrierInfo {
+        Image image;
+        vk::AccessFlags srcAccess = vk::AccessFlagBits::eShaderWrite;
+        vk::AccessFlags dstAccess = vk::AccessFlagBits::eShaderRead;
+        vk::PipelineStageFlags srcStage = vk::PipelineStageFlagBits::eComputeShader;
+        vk::PipelineStageFlags dstStage = vk::PipelineStageFlagBits::eComputeShader;
+    };
+
     class CommandBuffer_t;
     typedef std::shared_ptr<CommandBuffer_t> CommandBuffer;
 
@@ -36,6 +56,14 @@ namespace hd {
     struct TransitionImageLayoutInfo {
         Image image;
         vk::ImageLayout layout;
+        uint32_t baseMipLevel = 0;
+        uint32_t levelCount = VK_REMAINING_MIP_LEVELS;
+    };
+
+    // Expects level 0 filled and every level in eTransferDstOptimal
+    struct GenerateMipsInfo {
+        Image image;
+        vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal;
     };
 
     struct CopyBufferToBufferInfo {
@@ -49,6 +77,20 @@ namespace hd {
     struct CopyBufferToImageInfo {
         Buffer buffer;
         Image image;
+        vk::DeviceSize bufferOffset = 0;
+        vk::Offset3D imageOffset = { 0, 0, 0 };
+        vk::Extent3D imageExtent = { 0, 0, 0 };
+        uint32_t mipLevel = 0;
+        uint32_t arrayLayer = 0;
+    };
+
+    // Only for pipelines created with extendedDynamicState
+    struct DynamicStateInfo {
+        vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+        vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+        bool depthTest = true;
+        bool depthWrite = true;
+        vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
     };
 
     class CommandBuffer_t {
@@ -66,8 +108,14 @@ namespace hd {
 
             void barrier(BarrierCreateInfo ci);
 
+            void barrier(BufferBarrierInfo bi);
+
+            void barrier(ImageBarrierInfo bi);
+
             void transitionImageLayout(TransitionImageLayoutInfo ci);
 
+            void generateMips(GenerateMipsInfo ci);
+
             void begin();
 
             void begin(vk::CommandBufferUsageFlags flags);
@@ -84,6 +132,21 @@ namespace hd {
 
             void endRenderPass(CommandBuffer buffer);
 
+            // Viewport and scissor covering the whole extent
+            void setViewport(vk::Extent2D extent);
+
+            void setDynamicState(DynamicStateInfo di);
+
+            void dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1);
+
+            // Group counts come from a vk::DispatchIndirectCommand in the buffer
+            void dispatchIndirect(Buffer buffer, vk::DeviceSize offset = 0);
+
+            template<class Data>
+            void pushConstants(vk::PipelineLayout layout, vk::ShaderStageFlags stages, const Data& data, uint32_t offset = 0) {
+                _buffer.pushConstants(layout, stages, offset, sizeof(Data), &data);
+            }
+
             vk::CommandBuffer raw();
 
             ~CommandBuffer_t();
@@ -63,6 +63,17 @@ void CommandPool_t::singleTimeEnd(CommandBuffer buffer, Queue queue) {
     queue->waitIdle();
 }
 
+void CommandPool_t::singleTimeEnd(CommandBuffer buffer, Queue queue, Fence fence) {
+    buffer->end();
+
+    auto raw = buffer->raw();
+    vk::SubmitInfo si = {};
+    si.commandBufferCount = 1;
+    si.pCommandBuffers = &raw;
+    queue->submit(si, fence);
+    fence->wait();
+}
+
 vk::CommandPool CommandPool_t::raw() {
     return _commandPool;
 }
@@ -43,6 +43,8 @@ namespace hd {
 
             void singleTimeEnd(CommandBuffer buffer, Queue queue);
 
+            void singleTimeEnd(CommandBuffer buffer, Queue queue, Fence fence);
+
             vk::CommandPool raw();
 
             ~CommandPool_t();
@@ -6,7 +6,11 @@
 #include <hdvw/commandpool.hpp>
 #include <hdvw/queue.hpp>
 #include <hdvw/buffer.hpp>
+#include <hdvw/stagingring.hpp>
+#include <hdvw/upload.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 
 namespace hd {
@@ -15,9 +19,12 @@ namespace hd {
         CommandPool commandPool;
         Queue queue;
         Allocator allocator;
+        StagingRing stagingRing;
         std::vector<Data> data;
         vk::BufferUsageFlags usage;
         VmaMemoryUsage memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY;
+        UploadContext uploadContext = nullptr;
+        UploadBatch uploadBatch = nullptr;
     };
 
     template<class Data>
@@ -31,6 +38,7 @@ namespace hd {
         private:
             Buffer _buffer;
             uint64_t _entities;
+            UploadToken _token = nullptr;
 
         public:
             static DataBuffer<Data> conjure(DataBufferCreateInfo<Data> ci) {
@@ -41,18 +49,6 @@ namespace hd {
                 _entities = ci.data.size();
                 uint64_t _size = sizeof(ci.data[0]) * ci.data.size();
 
-                Buffer stagingBuffer = Buffer_t::conjure({
-                        .allocator = ci.allocator,
-                        .size = _size,
-                        .bufferUsage = vk::BufferUsageFlagBits::eTransferSrc,
-                        .memoryUsage = VMA_MEMORY_USAGE_CPU_ONLY,
-                        });
-
-                void* data = nullptr;
-                ci.allocator->map(stagingBuffer->memory(), data);
-                memcpy(data, ci.data.data(), (size_t) _size);
-                ci.allocator->unmap(stagingBuffer->memory());
-
                 _buffer = Buffer_t::conjure({
                         .allocator = ci.allocator,
                         .size = _size,
@@ -60,12 +56,35 @@ namespace hd {
                         .memoryUsage = ci.memoryUsage,
                         });
 
-                CommandBuffer cmd = ci.commandPool->singleTimeBegin();
-                cmd->copy({
-                        .srcBuffer = stagingBuffer,
-                        .dstBuffer = _buffer,
-                        });
-                ci.commandPool->singleTimeEnd(cmd, ci.queue);
+                if (ci.uploadBatch != nullptr) {
+                    ci.uploadBatch->upload(_buffer, ci.data.data(), _size);
+                    return;
+                }
+
+                if (ci.uploadContext != nullptr) {
+                    auto batch = UploadBatch_t::conjure({ .uploadContext = ci.uploadContext });
+                    batch->upload(_buffer, ci.data.data(), _size);
+                    _token = batch->flush();
+                    return;
+                }
+
+                auto bytes = reinterpret_cast<const char*>(ci.data.data());
+                for (uint64_t offset = 0; offset < _size; offset += ci.stagingRing->capacity()) {
+                    uint64_t chunk = std::min(_size - offset, ci.stagingRing->capacity());
+
+                    auto region = ci.stagingRing->allocate(chunk);
+                    memcpy(region.data, bytes + offset, (size_t) chunk);
+
+                    CommandBuffer cmd = ci.commandPool->singleTimeBegin();
+                    cmd->copy({
+                            .srcBuffer = region.buffer,
+                            .dstBuffer = _buffer,
+                            .srcOffset = region.offset,
+                            .dstOffset = offset,
+                            .size = chunk,
+                            });
+                    ci.commandPool->singleTimeEnd(cmd, ci.queue, ci.stagingRing->seal());
+                }
             }
 
             vk::DeviceSize size() {
@@ -83,5 +102,9 @@ namespace hd {
             VmaAllocation memory() {
                 return _buffer->memory();
             }
+
+            UploadToken token() {
+                return _token;
+            }
     };
 }
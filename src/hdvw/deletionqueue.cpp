@@ -0,0 +1,62 @@
+#include <hdvw/deletionqueue.hpp>
+using namespace hd;
+
+#include <vector>
+
+DeletionQueue_t::DeletionQueue_t(DeletionQueueCreateInfo ci) {
+    _framesInFlight = ci.framesInFlight;
+}
+
+void DeletionQueue_t::push(std::function<void()> deleter) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.push_back({ _frame, std::move(deleter) });
+}
+
+void DeletionQueue_t::advance() {
+    std::vector<std::function<void()>> ready;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _frame++;
+
+        while (!_entries.empty() && _entries.front().frame + _framesInFlight <= _frame) {
+            ready.push_back(std::move(_entries.front().deleter));
+            _entries.pop_front();
+        }
+    }
+
+    // Deleters may push more work, e.g. a pool releasing its children
+    for (auto& deleter : ready)
+        deleter();
+}
+
+// Only safe once the device is idle
+void DeletionQueue_t::flush() {
+    while (true) {
+        std::deque<Entry> entries;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            entries.swap(_entries);
+        }
+
+        if (entries.empty())
+            break;
+
+        for (auto& entry : entries)
+            entry.deleter();
+    }
+}
+
+uint64_t DeletionQueue_t::frame() {
+    return _frame;
+}
+
+size_t DeletionQueue_t::size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+DeletionQueue_t::~DeletionQueue_t() {
+    flush();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <memory>
+
+namespace hd {
+    struct DeletionQueueCreateInfo {
+        uint32_t framesInFlight = 3;
+    };
+
+    class DeletionQueue_t;
+    typedef std::shared_ptr<DeletionQueue_t> DeletionQueue;
+
+    // Destroys handles once the frames that might still use them have retired.
+    // Whatever is pushed during frame N runs in the advance() of frame N + framesInFlight,
+    // so advance() must be called right after waiting on the current frame's fence.
+    class DeletionQueue_t {
+        private:
+            struct Entry {
+                uint64_t frame;
+                std::function<void()> deleter;
+            };
+
+            std::deque<Entry> _entries;
+            std::mutex _mutex;
+
+            uint64_t _frame = 0;
+            uint32_t _framesInFlight;
+
+        public:
+            static DeletionQueue conjure(DeletionQueueCreateInfo ci) {
+                return std::make_shared<DeletionQueue_t>(ci);
+            }
+
+            DeletionQueue_t(DeletionQueueCreateInfo ci);
+
+            void push(std::function<void()> deleter);
+
+            template<class Handle>
+            void destroy(vk::Device device, Handle handle) {
+                push([device, handle]() {
+                        device.destroy(handle);
+                        });
+            }
+
+            void advance();
+
+            void flush();
+
+            uint64_t frame();
+
+            size_t size();
+
+            ~DeletionQueue_t();
+    };
+}
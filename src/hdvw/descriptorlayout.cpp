@@ -3,6 +3,7 @@ using namespace hd;
 
 DescriptorLayout_t::DescriptorLayout_t(DescriptorLayoutCreateInfo ci) {
     _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
 
     for (auto & binding: ci.bindings) {
         if (_types.find(binding.descriptorType) == _types.end())
@@ -27,5 +28,5 @@ vk::DescriptorSetLayout DescriptorLayout_t::raw() {
 }
 
 DescriptorLayout_t::~DescriptorLayout_t() {
-    _device.destroy(_layout);
+    _deletionQueue->destroy(_device, _layout);
 }
@@ -21,6 +21,7 @@ namespace hd {
         private:
             vk::DescriptorSetLayout _layout;
             vk::Device _device;
+            DeletionQueue _deletionQueue;
 
             std::map<vk::DescriptorType, uint32_t> _types;
 
@@ -3,13 +3,17 @@ using namespace hd;
 
 DescriptorPool_t::DescriptorPool_t(DescriptorPoolCreateInfo ci) {
     _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
     _instances = ci.instances;
 
     std::map<vk::DescriptorType, uint32_t> types;
+    uint32_t sets = 0;
 
+    // Each pair is a layout and how many sets of it one instance needs
     for (auto& mew : ci.layouts) {
         auto layoutTypes = mew.first->types();
-        auto typeMultiplier = mew.second;
+        auto typeMultiplier = mew.second * _instances;
+        sets += mew.second;
 
         for (auto& [key, val] : layoutTypes) {
             if (types.find(key) == types.end())
@@ -30,7 +34,7 @@ DescriptorPool_t::DescriptorPool_t(DescriptorPoolCreateInfo ci) {
     vk::DescriptorPoolCreateInfo pci = {};
     pci.poolSizeCount = sizes.size();
     pci.pPoolSizes = sizes.data();
-    pci.maxSets = _instances * ci.layouts.size();
+    pci.maxSets = _instances * sets;
 
     _pool = _device.createDescriptorPool(pci);
 }
@@ -61,5 +65,5 @@ vk::DescriptorPool DescriptorPool_t::raw() {
 }
 
 DescriptorPool_t::~DescriptorPool_t() {
-    _device.destroy(_pool);
+    _deletionQueue->destroy(_device, _pool);
 }
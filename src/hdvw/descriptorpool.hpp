@@ -23,6 +23,7 @@ namespace hd {
         private:
             vk::DescriptorPool _pool;
             vk::Device _device;
+            DeletionQueue _deletionQueue;
 
             uint32_t _instances = 1;
 
@@ -1,6 +1,7 @@
 #include <hdvw/device.hpp>
 using namespace hd;
 
+#include <algorithm>
 #include <string>
 #include <set>
 #include <iostream>
@@ -139,12 +140,64 @@ Device_t::Device_t(DeviceCreateInfo ci) {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    // Optional extensions are turned on only where the chosen device has them
+    std::vector<const char*> extensions = ci.extensions;
+    for (auto& ext : _physicalDevice.enumerateDeviceExtensionProperties())
+        for (auto& optional : ci.optionalExtensions)
+            if (static_cast<std::string>(ext.extensionName) == optional)
+                extensions.push_back(optional);
+
+    auto find = [&](const char* name) {
+        return std::find_if(extensions.begin(), extensions.end(), [&](auto enabled) {
+                return static_cast<std::string>(enabled) == name;
+                });
+    };
+
+    // Some extensions are useless without their feature bit, they are dropped when it isn't there
+    void* features = nullptr;
+
+    vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicState = {};
+    if (auto dynamicState = find(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME); dynamicState != extensions.end()) {
+        auto supported = _physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
+        if (supported.get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState) {
+            extendedDynamicState.extendedDynamicState = VK_TRUE;
+            extendedDynamicState.pNext = features;
+            features = &extendedDynamicState;
+        } else extensions.erase(dynamicState);
+    }
+
+#ifdef VK_EXT_graphics_pipeline_library
+    vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibrary = {};
+    if (auto library = find(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME); library != extensions.end()) {
+        auto supported = _physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+        if (find(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) != extensions.end()
+                && supported.get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>().graphicsPipelineLibrary) {
+            graphicsPipelineLibrary.graphicsPipelineLibrary = VK_TRUE;
+            graphicsPipelineLibrary.pNext = features;
+            features = &graphicsPipelineLibrary;
+        } else extensions.erase(library);
+    }
+#endif
+
+    _extensions = std::set<std::string>(extensions.begin(), extensions.end());
+
+    // Every member of the features struct is a VkBool32
+    _features = ci.features;
+    auto supportedFeatures = _physicalDevice.getFeatures();
+    auto enabled = reinterpret_cast<vk::Bool32*>(&_features);
+    auto optional = reinterpret_cast<const vk::Bool32*>(&ci.optionalFeatures);
+    auto supported = reinterpret_cast<const vk::Bool32*>(&supportedFeatures);
+    for (size_t feature = 0; feature < sizeof(vk::PhysicalDeviceFeatures) / sizeof(vk::Bool32); feature++)
+        if (optional[feature] && supported[feature])
+            enabled[feature] = VK_TRUE;
+
     vk::DeviceCreateInfo createInfo = {};
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    createInfo.pEnabledFeatures = &ci.features;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(ci.extensions.size());
-    createInfo.ppEnabledExtensionNames = ci.extensions.data();
+    createInfo.pEnabledFeatures = &_features;
+    createInfo.pNext = features;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if (ci.validationLayers.size()) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(ci.validationLayers.size());
@@ -155,6 +208,8 @@ Device_t::Device_t(DeviceCreateInfo ci) {
 
     _device = _physicalDevice.createDevice(createInfo);
     VULKAN_HPP_DEFAULT_DISPATCHER.init(_device);
+
+    _deletionQueue = DeletionQueue_t::conjure({ .framesInFlight = ci.framesInFlight });
 }
 
 void Device_t::waitIdle() {
@@ -165,8 +220,11 @@ vk::PhysicalDevice Device_t::physical() {
     return _physicalDevice;
 }
 
+// Out of date is reported through the result instead of being thrown
 vk::ResultValue<uint32_t> Device_t::acquireNextImage(vk::SwapchainKHR swapChain, vk::Semaphore semaphore) {
-    return _device.acquireNextImageKHR(swapChain, UINT64_MAX, semaphore, nullptr);
+    uint32_t index = 0;
+    auto result = _device.acquireNextImageKHR(swapChain, UINT64_MAX, semaphore, nullptr, &index);
+    return vk::ResultValue<uint32_t>(result, index);
 }
 
 vk::Device Device_t::raw() {
@@ -177,6 +235,18 @@ QueueFamilyIndices Device_t::indices() {
     return _indices;
 }
 
+bool Device_t::extensionEnabled(const std::string& name) {
+    return _extensions.count(name) > 0;
+}
+
+vk::PhysicalDeviceFeatures Device_t::features() {
+    return _features;
+}
+
+DeletionQueue Device_t::deletionQueue() {
+    return _deletionQueue;
+}
+
 void Device_t::updateSurfaceInfo() {
     _swapChainSupport.capabilities = _physicalDevice.getSurfaceCapabilitiesKHR(_surface);
 }
@@ -186,5 +256,7 @@ SwapChainSupportDetails Device_t::swapChainSupport() {
 }
 
 Device_t::~Device_t() {
+    _device.waitIdle();
+    _deletionQueue->flush();
     _device.destroy();
 }
@@ -4,10 +4,13 @@
 
 #include <hdvw/instance.hpp>
 #include <hdvw/surface.hpp>
+#include <hdvw/deletionqueue.hpp>
 
 #include <vector>
 #include <optional>
 #include <memory>
+#include <set>
+#include <string>
 
 namespace hd {
     struct QueueFamilyIndices {
@@ -29,8 +32,12 @@ namespace hd {
         Surface surface = nullptr;
         QueueFamilyIndices (*findQueueFamilies) (vk::PhysicalDevice, Surface) = nullptr;
         std::vector<const char*> extensions;
+        std::vector<const char*> optionalExtensions = {};
         vk::PhysicalDeviceFeatures features;
+        // Turned on only where the chosen device has them, check features() afterwards
+        vk::PhysicalDeviceFeatures optionalFeatures = {};
         std::vector<const char*> validationLayers;
+        uint32_t framesInFlight = 3;
     };
 
     struct SwapChainSupportDetails {
@@ -49,6 +56,9 @@ namespace hd {
             vk::SurfaceKHR _surface;
             QueueFamilyIndices _indices;
             SwapChainSupportDetails _swapChainSupport;
+            std::set<std::string> _extensions;
+            vk::PhysicalDeviceFeatures _features;
+            DeletionQueue _deletionQueue;
 
             QueueFamilyIndices findQueueFamilies(vk::PhysicalDevice physicalDevice, Surface surface);
 
@@ -80,6 +90,12 @@ namespace hd {
 
             QueueFamilyIndices indices();
 
+            bool extensionEnabled(const std::string& name);
+
+            vk::PhysicalDeviceFeatures features();
+
+            DeletionQueue deletionQueue();
+
             void updateSurfaceInfo();
 
             SwapChainSupportDetails swapChainSupport();
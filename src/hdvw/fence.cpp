@@ -19,6 +19,10 @@ void Fence_t::reset() {
     _device.resetFences(_fence);
 }
 
+bool Fence_t::signaled() {
+    return _device.getFenceStatus(_fence) == vk::Result::eSuccess;
+}
+
 vk::Fence Fence_t::raw() {
     return _fence;
 }
@@ -36,6 +36,8 @@ namespace hd {
 
             void reset();
 
+            bool signaled();
+
             vk::Fence raw();
 
             ~Fence_t();
@@ -0,0 +1,70 @@
+#include <hdvw/format.hpp>
+using namespace hd;
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+uint32_t hd::mipLevelCount(vk::Extent2D extent) {
+    return std::bit_width(std::max(extent.width, extent.height));
+}
+
+vk::Extent2D hd::formatBlockExtent(vk::Format format) {
+    switch (format) {
+        case vk::Format::eBc1RgbUnormBlock:
+        case vk::Format::eBc1RgbSrgbBlock:
+        case vk::Format::eBc1RgbaUnormBlock:
+        case vk::Format::eBc1RgbaSrgbBlock:
+        case vk::Format::eBc2UnormBlock:
+        case vk::Format::eBc2SrgbBlock:
+        case vk::Format::eBc3UnormBlock:
+        case vk::Format::eBc3SrgbBlock:
+        case vk::Format::eBc4UnormBlock:
+        case vk::Format::eBc4SnormBlock:
+        case vk::Format::eBc5UnormBlock:
+        case vk::Format::eBc5SnormBlock:
+        case vk::Format::eBc6HUfloatBlock:
+        case vk::Format::eBc6HSfloatBlock:
+        case vk::Format::eBc7UnormBlock:
+        case vk::Format::eBc7SrgbBlock:
+            return { 4, 4 };
+        default:
+            return { 1, 1 };
+    }
+}
+
+uint32_t hd::formatBlockSize(vk::Format format) {
+    switch (format) {
+        case vk::Format::eR8Unorm:
+            return 1;
+        case vk::Format::eR8G8Unorm:
+            return 2;
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eB8G8R8A8Unorm:
+        case vk::Format::eB8G8R8A8Srgb:
+            return 4;
+        case vk::Format::eR16G16B16A16Sfloat:
+        case vk::Format::eBc1RgbUnormBlock:
+        case vk::Format::eBc1RgbSrgbBlock:
+        case vk::Format::eBc1RgbaUnormBlock:
+        case vk::Format::eBc1RgbaSrgbBlock:
+        case vk::Format::eBc4UnormBlock:
+        case vk::Format::eBc4SnormBlock:
+            return 8;
+        case vk::Format::eR32G32B32A32Sfloat:
+        case vk::Format::eBc2UnormBlock:
+        case vk::Format::eBc2SrgbBlock:
+        case vk::Format::eBc3UnormBlock:
+        case vk::Format::eBc3SrgbBlock:
+        case vk::Format::eBc5UnormBlock:
+        case vk::Format::eBc5SnormBlock:
+        case vk::Format::eBc6HUfloatBlock:
+        case vk::Format::eBc6HSfloatBlock:
+        case vk::Format::eBc7UnormBlock:
+        case vk::Format::eBc7SrgbBlock:
+            return 16;
+        default:
+            throw std::invalid_argument("unsupported texture format!");
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+
+namespace hd {
+    // Length of the full mip chain down to 1x1
+    uint32_t mipLevelCount(vk::Extent2D extent);
+
+    // Texels per block, 4x4 for block compressed formats
+    vk::Extent2D formatBlockExtent(vk::Format format);
+
+    // Bytes per block, or per texel for uncompressed formats
+    uint32_t formatBlockSize(vk::Format format);
+}
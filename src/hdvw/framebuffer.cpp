@@ -3,6 +3,7 @@ using namespace hd;
 
 Framebuffer_t::Framebuffer_t(FramebufferCreateInfo ci) {
     _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
 
     vk::FramebufferCreateInfo framebufferInfo = {};
     framebufferInfo.renderPass = ci.renderPass->raw();
@@ -20,5 +21,5 @@ vk::Framebuffer Framebuffer_t::raw() {
 }
 
 Framebuffer_t::~Framebuffer_t() {
-    _device.destroy(_framebuffer);
+    _deletionQueue->destroy(_device, _framebuffer);
 }
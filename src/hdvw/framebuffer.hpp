@@ -22,6 +22,7 @@ namespace hd {
         private:
             vk::Framebuffer _framebuffer;
             vk::Device _device;
+            DeletionQueue _deletionQueue;
 
         public:
             static Framebuffer conjure(FramebufferCreateInfo ci) {
@@ -0,0 +1,145 @@
+#include <hdvw/geometryarena.hpp>
+using namespace hd;
+
+#include <iterator>
+#include <stdexcept>
+
+FreeList::FreeList(uint64_t capacity) {
+    _capacity = capacity;
+    if (capacity > 0)
+        _free[0] = capacity;
+}
+
+std::optional<uint64_t> FreeList::allocate(uint64_t size) {
+    for (auto iter = _free.begin(); iter != _free.end(); iter++) {
+        if (iter->second < size)
+            continue;
+
+        uint64_t offset = iter->first;
+        uint64_t left = iter->second - size;
+
+        _free.erase(iter);
+        if (left > 0)
+            _free[offset + size] = left;
+
+        _used += size;
+        return offset;
+    }
+
+    return std::nullopt;
+}
+
+void FreeList::free(uint64_t offset, uint64_t size) {
+    if (size == 0)
+        return;
+
+    _used -= size;
+    auto next = _free.lower_bound(offset);
+
+    if (next != _free.end() && offset + size == next->first) {
+        size += next->second;
+        next = _free.erase(next);
+    }
+
+    if (next != _free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+
+    _free[offset] = size;
+}
+
+uint64_t FreeList::capacity() {
+    return _capacity;
+}
+
+uint64_t FreeList::used() {
+    return _used;
+}
+
+GeometryArena_t::GeometryArena_t(GeometryArenaCreateInfo ci) {
+    _vertexStride = ci.vertexStride;
+    _deletionQueue = ci.device->deletionQueue();
+    _vertices = std::make_shared<FreeList>(ci.vertexCapacity);
+    _indices = std::make_shared<FreeList>(ci.indexCapacity);
+
+    // Shared with the transfer family so later uploads don't need ownership transfers
+    auto indices = ci.device->indices();
+    std::vector<uint32_t> families = { indices.graphicsFamily.value() };
+    if (indices.transferFamily.has_value())
+        families.push_back(indices.transferFamily.value());
+
+    _vertexBuffer = Buffer_t::conjure({
+            .allocator = ci.allocator,
+            .size = _vertexStride * ci.vertexCapacity,
+            .bufferUsage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+            .memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .queueFamilies = families,
+            .movable = true,
+            });
+
+    _indexBuffer = Buffer_t::conjure({
+            .allocator = ci.allocator,
+            .size = sizeof(uint32_t) * ci.indexCapacity,
+            .bufferUsage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
+            .memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .queueFamilies = families,
+            .movable = true,
+            });
+}
+
+GeometryAllocation GeometryArena_t::allocate(GeometryUploadInfo ui) {
+    auto vertexOffset = _vertices->allocate(ui.vertexCount);
+    if (!vertexOffset.has_value())
+        throw std::runtime_error("Geometry arena is out of vertex space");
+
+    auto firstIndex = _indices->allocate(ui.indexCount);
+    if (!firstIndex.has_value()) {
+        _vertices->free(vertexOffset.value(), ui.vertexCount);
+        throw std::runtime_error("Geometry arena is out of index space");
+    }
+
+    GeometryAllocation allocation = {};
+    allocation.vertexOffset = static_cast<int32_t>(vertexOffset.value());
+    allocation.vertexCount = ui.vertexCount;
+    allocation.firstIndex = static_cast<uint32_t>(firstIndex.value());
+    allocation.indexCount = ui.indexCount;
+
+    if (ui.vertexCount > 0)
+        ui.uploadBatch->upload(_vertexBuffer, ui.vertices, _vertexStride * ui.vertexCount,
+                _vertexStride * allocation.vertexOffset);
+
+    if (ui.indexCount > 0)
+        ui.uploadBatch->upload(_indexBuffer, ui.indices, sizeof(uint32_t) * ui.indexCount,
+                sizeof(uint32_t) * allocation.firstIndex);
+
+    return allocation;
+}
+
+void GeometryArena_t::free(GeometryAllocation allocation) {
+    _deletionQueue->push([vertices = _vertices, indices = _indices, allocation]() {
+            vertices->free(allocation.vertexOffset, allocation.vertexCount);
+            indices->free(allocation.firstIndex, allocation.indexCount);
+            });
+}
+
+void GeometryArena_t::bind(CommandBuffer buffer) {
+    vk::DeviceSize offset = 0;
+    buffer->raw().bindVertexBuffers(0, _vertexBuffer->raw(), offset);
+    buffer->raw().bindIndexBuffer(_indexBuffer->raw(), 0, vk::IndexType::eUint32);
+}
+
+void GeometryArena_t::draw(CommandBuffer buffer, GeometryAllocation allocation, uint32_t instances) {
+    buffer->raw().drawIndexed(allocation.indexCount, instances, allocation.firstIndex, allocation.vertexOffset, 0);
+}
+
+vk::Buffer GeometryArena_t::vertexBuffer() {
+    return _vertexBuffer->raw();
+}
+
+vk::Buffer GeometryArena_t::indexBuffer() {
+    return _indexBuffer->raw();
+}
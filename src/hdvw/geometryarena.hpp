@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/allocator.hpp>
+#include <hdvw/buffer.hpp>
+#include <hdvw/commandbuffer.hpp>
+#include <hdvw/upload.hpp>
+#include <hdvw/vertex.hpp>
+
+#include <map>
+#include <vector>
+#include <optional>
+#include <memory>
+
+namespace hd {
+    // First-fit range allocator, neighbouring free ranges are merged on free()
+    class FreeList {
+        private:
+            std::map<uint64_t, uint64_t> _free;
+            uint64_t _capacity;
+            uint64_t _used = 0;
+
+        public:
+            FreeList(uint64_t capacity = 0);
+
+            std::optional<uint64_t> allocate(uint64_t size);
+
+            void free(uint64_t offset, uint64_t size);
+
+            uint64_t capacity();
+
+            uint64_t used();
+    };
+
+    struct GeometryArenaCreateInfo {
+        Device device;
+        Allocator allocator;
+        vk::DeviceSize vertexStride = sizeof(Vertex);
+        uint32_t vertexCapacity = 1 << 20;
+        uint32_t indexCapacity = 1 << 22;
+    };
+
+    struct GeometryAllocation {
+        int32_t vertexOffset = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct GeometryUploadInfo {
+        UploadBatch uploadBatch;
+        const void* vertices;
+        uint32_t vertexCount;
+        const uint32_t* indices;
+        uint32_t indexCount;
+    };
+
+    class GeometryArena_t;
+    typedef std::shared_ptr<GeometryArena_t> GeometryArena;
+
+    // One vertex and one index buffer shared by every mesh, so a scene binds once
+    // and draws with base-vertex / first-index offsets.
+    class GeometryArena_t {
+        private:
+            Buffer _vertexBuffer;
+            Buffer _indexBuffer;
+            vk::DeviceSize _vertexStride;
+            DeletionQueue _deletionQueue;
+
+            // Shared with pending frees, which may run after the arena is gone
+            std::shared_ptr<FreeList> _vertices;
+            std::shared_ptr<FreeList> _indices;
+
+        public:
+            static GeometryArena conjure(GeometryArenaCreateInfo ci) {
+                return std::make_shared<GeometryArena_t>(ci);
+            }
+
+            GeometryArena_t(GeometryArenaCreateInfo ci);
+
+            GeometryAllocation allocate(GeometryUploadInfo ui);
+
+            template<class V>
+            GeometryAllocation allocate(UploadBatch batch, const std::vector<V>& vertices, const std::vector<uint32_t>& indices) {
+                return allocate({
+                        .uploadBatch = batch,
+                        .vertices = vertices.data(),
+                        .vertexCount = static_cast<uint32_t>(vertices.size()),
+                        .indices = indices.data(),
+                        .indexCount = static_cast<uint32_t>(indices.size()),
+                        });
+            }
+
+            // The ranges are reused once frames in flight can no longer draw from them
+            void free(GeometryAllocation allocation);
+
+            void bind(CommandBuffer buffer);
+
+            void draw(CommandBuffer buffer, GeometryAllocation allocation, uint32_t instances = 1);
+
+            vk::Buffer vertexBuffer();
+
+            vk::Buffer indexBuffer();
+    };
+}
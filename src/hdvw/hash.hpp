@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace hd {
+    const uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+
+    // 64 bit FNV-1a, pass a previous result as seed to continue hashing
+    inline uint64_t fnv1a(std::span<const std::byte> data, uint64_t seed = FNV_OFFSET) {
+        uint64_t hash = seed;
+        for (auto byte: data) {
+            hash ^= static_cast<uint8_t>(byte);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    template<class Value>
+    uint64_t fnv1a(const Value& value, uint64_t seed = FNV_OFFSET) {
+        return fnv1a(std::as_bytes(std::span(&value, 1)), seed);
+    }
+}
@@ -1,47 +1,86 @@
 #include <hdvw/image.hpp>
 using namespace hd;
 
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+bool hd::supportsLinearBlit(Device device, vk::Format format) {
+    auto features = device->physical().getFormatProperties(format).optimalTilingFeatures;
+    return (features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear)
+        && (features & vk::FormatFeatureFlagBits::eBlitSrc)
+        && (features & vk::FormatFeatureFlagBits::eBlitDst);
+}
+
 Image_t::Image_t(ImageCreateInfo ci) {
     _allocator = ci.allocator;
     _imageSize = ci.extent;
-    _layout = vk::ImageLayout::eUndefined;
     _format = ci.format;
+
+    if (ci.mipLevels == 0 || ci.mipLevels > mipLevelCount(ci.extent))
+        throw std::invalid_argument("Mip level count does not fit the image extent");
     _range.aspectMask = ci.aspect;
     _range.baseArrayLayer = 0;
     _range.baseMipLevel = 0;
     _range.layerCount = ci.layers;
-    _range.levelCount = 1;
+    _range.levelCount = ci.mipLevels;
+    _layouts.assign(ci.mipLevels, vk::ImageLayout::eUndefined);
 
     vk::ImageCreateInfo ici = {};
     ici.imageType = vk::ImageType::e2D;
     ici.extent.width = ci.extent.width;
     ici.extent.height = ci.extent.height;
     ici.extent.depth = 1;
-    ici.mipLevels = 1;
+    ici.mipLevels = _range.levelCount;
     ici.arrayLayers = _range.layerCount;
     ici.format = _format;
     ici.tiling = vk::ImageTiling::eOptimal;
-    ici.initialLayout = _layout;
+    ici.initialLayout = vk::ImageLayout::eUndefined;
     ici.usage = ci.imageUsage;
     ici.samples = vk::SampleCountFlagBits::e1;
     ici.sharingMode = vk::SharingMode::eExclusive;
     ici.flags = ci.flags;
 
-    auto result = _allocator->create(ici, ci.memoryUsage);
+    _info = ici;
+
+    auto result = _allocator->create(ici, ci.memoryUsage, ci.pool, ci.category);
     _image = result.image;
     _imageMemory = result.allocation;
+    _allocationId = result.id;
+
+    if (ci.movable) {
+        auto transfer = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+        if ((ci.imageUsage & transfer) != transfer || ci.category == MemoryCategory::eAttachment)
+            throw std::invalid_argument("Only images with transfer usage that aren't attachments can be movable");
+        _allocator->setOwner(_imageMemory, this);
+    }
+}
+
+vk::Extent2D Image_t::extent(uint32_t level) {
+    return { std::max(_imageSize.width >> level, 1u), std::max(_imageSize.height >> level, 1u) };
+}
+
+uint32_t Image_t::mipLevels() {
+    return _range.levelCount;
 }
 
-vk::Extent2D Image_t::extent() {
-    return _imageSize;
+uint32_t Image_t::layers() {
+    return _range.layerCount;
 }
 
-vk::ImageLayout Image_t::layout() {
-    return _layout;
+vk::ImageLayout Image_t::layout(uint32_t level) {
+    return _layouts.at(level);
 }
 
 void Image_t::setLayout(vk::ImageLayout layout) {
-    _layout = layout;
+    std::fill(_layouts.begin(), _layouts.end(), layout);
+}
+
+void Image_t::setLayout(vk::ImageLayout layout, uint32_t baseLevel, uint32_t levelCount) {
+    if (levelCount == VK_REMAINING_MIP_LEVELS)
+        levelCount = _range.levelCount - baseLevel;
+
+    std::fill_n(_layouts.begin() + baseLevel, levelCount, layout);
 }
 
 vk::ImageSubresourceRange Image_t::range() {
@@ -56,16 +95,106 @@ VmaAllocation Image_t::memory() {
     return _imageMemory;
 }
 
+uint64_t Image_t::generation() {
+    return _generation;
+}
+
+// Keeps objects made from the current handle, such as views, alive until it is retired
+void Image_t::retain(std::shared_ptr<void> dependent) {
+    _retained.push_back(dependent);
+}
+
+void Image_t::relocate(Relocation relocation) {
+    auto image = relocation.device.createImage(_info);
+    relocation.device.bindImageMemory(image, relocation.memory, relocation.offset);
+
+    // Moves only happen between frames, when every level is back in one layout
+    auto layout = _layouts.front();
+
+    // Nothing worth copying yet
+    if (layout == vk::ImageLayout::eUndefined) {
+        _retired.push_back(_image);
+        _image = image;
+        _generation++;
+        return;
+    }
+
+    std::array<vk::ImageMemoryBarrier, 2> barriers;
+    barriers[0].oldLayout = layout;
+    barriers[0].newLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barriers[0].srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+    barriers[0].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    barriers[0].image = _image;
+    barriers[0].subresourceRange = _range;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    barriers[1].oldLayout = vk::ImageLayout::eUndefined;
+    barriers[1].newLayout = vk::ImageLayout::eTransferDstOptimal;
+    barriers[1].dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barriers[1].image = image;
+    barriers[1].subresourceRange = _range;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    auto cmd = relocation.commandBuffer;
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+            vk::DependencyFlags{0}, nullptr, nullptr, barriers);
+
+    std::vector<vk::ImageCopy> regions(_range.levelCount);
+    for (uint32_t level = 0; level < _range.levelCount; level++) {
+        auto& region = regions[level];
+        region.srcSubresource = vk::ImageSubresourceLayers(_range.aspectMask, level, 0, _range.layerCount);
+        region.dstSubresource = region.srcSubresource;
+        region.extent = vk::Extent3D{
+            std::max(_info.extent.width >> level, 1u),
+            std::max(_info.extent.height >> level, 1u),
+            std::max(_info.extent.depth >> level, 1u),
+        };
+    }
+
+    cmd.copyImage(_image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+    // The old image stays in use by descriptors until they are rewritten, so both go back
+    std::array<vk::ImageMemoryBarrier, 2> back = barriers;
+    back[0].oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    back[0].newLayout = layout;
+    back[0].srcAccessMask = vk::AccessFlagBits::eTransferRead;
+    back[0].dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+
+    back[1].oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    back[1].newLayout = layout;
+    back[1].srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    back[1].dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+            vk::DependencyFlags{0}, nullptr, nullptr, back);
+
+    _retired.push_back(_image);
+    _image = image;
+    _generation++;
+}
+
+void Image_t::retire(vk::Device device) {
+    _retained.clear();
+
+    for (auto& image : _retired)
+        device.destroy(image);
+    _retired.clear();
+}
+
 vk::Image Image_t::raw() {
     return _image;
 }
 
 Image_t::~Image_t() {
-    _allocator->destroy(_image, _imageMemory);
+    for (auto& image : _retired)
+        _allocator->deletionQueue()->destroy(_allocator->device(), image);
+    _allocator->destroy(_image, _imageMemory, _allocationId);
 }
 
 ImageView_t::ImageView_t(ImageViewCreateInfo ci) {
     _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
 
     vk::ImageViewCreateInfo ivci;
     ivci.image = ci.image;
@@ -81,11 +210,12 @@ vk::ImageView ImageView_t::raw() {
 }
 
 ImageView_t::~ImageView_t() {
-    _device.destroy(_view);
+    _deletionQueue->destroy(_device, _view);
 }
 
 Sampler_t::Sampler_t(SamplerCreateInfo ci) {
     _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
 
     vk::SamplerCreateInfo si = {};
     si.magFilter = vk::Filter::eLinear;
@@ -100,6 +230,8 @@ Sampler_t::Sampler_t(SamplerCreateInfo ci) {
     si.compareEnable = VK_FALSE;
     si.compareOp = vk::CompareOp::eAlways;
     si.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    si.minLod = 0.0f;
+    si.maxLod = ci.maxLod;
 
     _sampler = _device.createSampler(si);
 }
@@ -109,5 +241,5 @@ vk::Sampler Sampler_t::raw() {
 }
 
 Sampler_t::~Sampler_t() {
-    _device.destroy(_sampler);
+    _deletionQueue->destroy(_device, _sampler);
 }
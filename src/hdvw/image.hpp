@@ -4,8 +4,12 @@
 
 #include <hdvw/device.hpp>
 #include <hdvw/allocator.hpp>
+#include <hdvw/format.hpp>
 
+#include <compare>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace hd {
     struct ImageCreateInfo {
@@ -14,21 +18,36 @@ namespace hd {
         vk::Format format = vk::Format::eR8G8B8A8Srgb;
         vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
         uint32_t layers = 1;
+        uint32_t mipLevels = 1;
         vk::ImageCreateFlags flags = vk::ImageCreateFlags{0};
         vk::ImageUsageFlags imageUsage = vk::ImageUsageFlagBits::eSampled;
         VmaMemoryUsage memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY;
+        std::string pool = "";
+        MemoryCategory category = MemoryCategory::eImage;
+        // Lets defragmentation move the image, needs transfer source and destination usage.
+        // Whoever holds views or descriptors of it has to follow generation().
+        bool movable = false;
     };
 
+    // Whether generateMips() can blit the chain for this format
+    bool supportsLinearBlit(Device device, vk::Format format);
+
     class Image_t;
     typedef std::shared_ptr<Image_t> Image;
 
-    class Image_t {
+    class Image_t : public Movable_t {
         private:
             vk::Image _image;
             VmaAllocation _imageMemory;
+            uint64_t _allocationId;
+            vk::ImageCreateInfo _info;
+            std::vector<vk::Image> _retired;
+            std::vector<std::shared_ptr<void>> _retained;
+            uint64_t _generation = 0;
 
             vk::Extent2D _imageSize;
-            vk::ImageLayout _layout;
+            // One per mip level, every array layer of a level shares it
+            std::vector<vk::ImageLayout> _layouts;
             vk::Format _format;
             vk::ImageSubresourceRange _range;
             Allocator _allocator;
@@ -40,18 +59,32 @@ namespace hd {
 
             Image_t(ImageCreateInfo ci);
 
-            vk::Extent2D extent();
+            vk::Extent2D extent(uint32_t level = 0);
+
+            uint32_t mipLevels();
+
+            uint32_t layers();
 
-            vk::ImageLayout layout();
+            vk::ImageLayout layout(uint32_t level = 0);
 
             void setLayout(vk::ImageLayout layout);
 
+            void setLayout(vk::ImageLayout layout, uint32_t baseLevel, uint32_t levelCount);
+
             vk::ImageSubresourceRange range();
 
             vk::Format format();
 
             VmaAllocation memory();
 
+            uint64_t generation();
+
+            void retain(std::shared_ptr<void> dependent);
+
+            void relocate(Relocation relocation) override;
+
+            void retire(vk::Device device) override;
+
             vk::Image raw();
 
             ~Image_t();
@@ -72,6 +105,7 @@ namespace hd {
         private:
             vk::ImageView _view;
             vk::Device _device;
+            DeletionQueue _deletionQueue;
 
         public:
             static ImageView conjure(ImageViewCreateInfo ci) {
@@ -88,6 +122,10 @@ namespace hd {
     struct SamplerCreateInfo {
         Device device;
         vk::SamplerAddressMode addressMode = vk::SamplerAddressMode::eRepeat;
+        float maxLod = VK_LOD_CLAMP_NONE;
+
+        // Every field takes part, ResourceCache_t keys samplers on the whole struct
+        auto operator<=>(const SamplerCreateInfo&) const = default;
     };
 
     class Sampler_t;
@@ -97,6 +135,7 @@ namespace hd {
         private:
             vk::Sampler _sampler;
             vk::Device _device;
+            DeletionQueue _deletionQueue;
 
         public:
             static Sampler conjure(SamplerCreateInfo ci) {
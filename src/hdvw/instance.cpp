@@ -36,6 +36,7 @@ void Instance_t::populateDebugMessengerCreateInfo(vk::DebugUtilsMessengerCreateI
 
 Instance_t::Instance_t(InstanceCreateInfo ci) {
     evl = ci.validationLayers.size() > 0;
+    _apiVersion = ci.apiVersion;
 
     vk::DynamicLoader dl;
     PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
@@ -86,6 +87,10 @@ vk::Instance Instance_t::raw() {
     return _instance;
 }
 
+uint32_t Instance_t::apiVersion() {
+    return _apiVersion;
+}
+
 Instance_t::~Instance_t() {
     if (evl)
         _instance.destroyDebugUtilsMessengerEXT(debugMessenger, nullptr);
@@ -25,6 +25,7 @@ namespace hd {
             vk::Instance _instance;
             vk::DebugUtilsMessengerEXT debugMessenger;
             bool evl = false;
+            uint32_t _apiVersion;
 
             bool checkValidationLayerSupport(std::vector<const char*>* validationLayers);
 
@@ -46,6 +47,8 @@ namespace hd {
 
             vk::Instance raw();
 
+            uint32_t apiVersion();
+
             ~Instance_t();
     };
 };
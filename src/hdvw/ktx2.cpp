@@ -0,0 +1,115 @@
+#include <hdvw/ktx2.hpp>
+using namespace hd;
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    struct Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    struct LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+}
+
+Ktx2File_t::Ktx2File_t(Ktx2FileCreateInfo ci) {
+    _file = MappedFile_t::conjure({ .filename = ci.filename });
+    auto data = _file->data();
+
+    auto invalid = [&](const char* reason) {
+        return std::runtime_error(std::string(ci.filename) + ": " + reason);
+    };
+
+    Header header;
+    if (data.size() < sizeof(header))
+        throw invalid("file is too small for a KTX2 header");
+    memcpy(&header, data.data(), sizeof(header));
+
+    if (memcmp(header.identifier, identifier, sizeof(identifier)) != 0)
+        throw invalid("not a KTX2 file");
+    if (header.supercompressionScheme != 0)
+        throw invalid("supercompressed KTX2 files are not supported");
+    if (header.pixelDepth > 1 || header.faceCount != 1)
+        throw invalid("only 2D textures and arrays are supported");
+    // 1D files store a height of 0, the upload paths divide by the block rows
+    if (header.pixelWidth == 0 || header.pixelHeight == 0)
+        throw invalid("only 2D textures and arrays are supported");
+    if (header.vkFormat == VK_FORMAT_UNDEFINED)
+        throw invalid("basis universal payloads are not supported");
+
+    _format = static_cast<vk::Format>(header.vkFormat);
+    _extent = { header.pixelWidth, header.pixelHeight };
+    _layers = std::max(header.layerCount, 1u);
+
+    auto block = formatBlockExtent(_format);
+    auto blockSize = formatBlockSize(_format);
+
+    // A level count of zero asks the loader to generate the chain, only level 0 is stored
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+    if (levelCount > mipLevelCount(_extent))
+        throw invalid("more levels than the extent allows");
+
+    if (data.size() < sizeof(header) + levelCount * sizeof(LevelIndex))
+        throw invalid("truncated level index");
+
+    _levels.reserve(levelCount);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        LevelIndex index;
+        memcpy(&index, data.data() + sizeof(header) + level * sizeof(LevelIndex), sizeof(index));
+
+        auto extent = this->extent(level);
+        uint64_t expected = (uint64_t) _layers * blockSize
+            * ((extent.width + block.width - 1) / block.width)
+            * ((extent.height + block.height - 1) / block.height);
+
+        if (index.byteLength != expected)
+            throw invalid("level size does not match its format and extent");
+        if (index.byteOffset > data.size() || index.byteLength > data.size() - index.byteOffset)
+            throw invalid("level runs past the end of the file");
+
+        _levels.push_back(data.subspan(index.byteOffset, index.byteLength));
+    }
+}
+
+std::span<const std::byte> Ktx2File_t::level(uint32_t level) {
+    return _levels.at(level);
+}
+
+vk::Format Ktx2File_t::format() {
+    return _format;
+}
+
+vk::Extent2D Ktx2File_t::extent(uint32_t level) {
+    return { std::max(_extent.width >> level, 1u), std::max(_extent.height >> level, 1u) };
+}
+
+uint32_t Ktx2File_t::layers() {
+    return _layers;
+}
+
+uint32_t Ktx2File_t::mipLevels() {
+    return _levels.size();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/mappedfile.hpp>
+#include <hdvw/format.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace hd {
+    struct Ktx2FileCreateInfo {
+        const char* filename;
+    };
+
+    class Ktx2File_t;
+    typedef std::shared_ptr<Ktx2File_t> Ktx2File;
+
+    // KTX2 container holding GPU-ready data, levels point straight into the mapped file.
+    // Only 2D textures and arrays without supercompression are accepted.
+    class Ktx2File_t {
+        private:
+            MappedFile _file;
+            vk::Format _format;
+            vk::Extent2D _extent;
+            uint32_t _layers;
+            std::vector<std::span<const std::byte>> _levels;
+
+        public:
+            static Ktx2File conjure(Ktx2FileCreateInfo ci) {
+                return std::make_shared<Ktx2File_t>(ci);
+            }
+
+            Ktx2File_t(Ktx2FileCreateInfo ci);
+
+            // Level 0 is the largest, every array layer of a level follows one another
+            std::span<const std::byte> level(uint32_t level);
+
+            vk::Format format();
+
+            vk::Extent2D extent(uint32_t level = 0);
+
+            uint32_t layers();
+
+            uint32_t mipLevels();
+    };
+}
@@ -0,0 +1,120 @@
+#include <hdvw/layoutcache.hpp>
+using namespace hd;
+
+#include <algorithm>
+#include <stdexcept>
+
+LayoutCache_t::LayoutCache_t(LayoutCacheCreateInfo ci) {
+    _device = ci.device;
+}
+
+DescriptorLayout LayoutCache_t::descriptorLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings,
+        vk::DescriptorSetLayoutCreateFlags flags) {
+    std::sort(bindings.begin(), bindings.end(), [](auto& a, auto& b) {
+            return a.binding < b.binding;
+            });
+
+    std::vector<BindingKey> bindingKeys;
+    bindingKeys.reserve(bindings.size());
+    for (auto& binding: bindings) {
+        std::vector<uint64_t> samplers;
+        if (binding.pImmutableSamplers)
+            for (uint32_t iter = 0; iter < binding.descriptorCount; iter++)
+                samplers.push_back((uint64_t) static_cast<VkSampler>(binding.pImmutableSamplers[iter]));
+
+        bindingKeys.push_back({
+                binding.binding,
+                binding.descriptorType,
+                binding.descriptorCount,
+                static_cast<uint32_t>(binding.stageFlags),
+                samplers,
+                });
+    }
+
+    auto& layout = _descriptorLayouts[{ static_cast<uint32_t>(flags), bindingKeys }];
+    if (!layout)
+        layout = DescriptorLayout_t::conjure({
+                .device = _device,
+                .bindings = bindings,
+                .flags = flags,
+                });
+
+    return layout;
+}
+
+PipelineLayout LayoutCache_t::pipelineLayout(const std::vector<DescriptorLayout>& descriptorLayouts,
+        const std::vector<vk::PushConstantRange>& pushConstants) {
+    PipelineKey key;
+    std::vector<vk::DescriptorSetLayout> raw;
+    for (auto& layout: descriptorLayouts) {
+        raw.push_back(layout->raw());
+        std::get<0>(key).push_back((uint64_t) static_cast<VkDescriptorSetLayout>(layout->raw()));
+    }
+    for (auto& range: pushConstants)
+        std::get<1>(key).push_back({ static_cast<uint32_t>(range.stageFlags), range.offset, range.size });
+
+    auto& entry = _pipelineLayouts[key];
+    if (!entry.pipelineLayout) {
+        entry.descriptorLayouts = descriptorLayouts;
+        entry.pipelineLayout = PipelineLayout_t::conjure({
+                .device = _device,
+                .descriptorLayouts = raw,
+                .pushConstants = pushConstants,
+                });
+    }
+
+    return entry.pipelineLayout;
+}
+
+ReflectedLayout LayoutCache_t::reflect(ReflectedLayoutInfo info) {
+    std::vector<ShaderReflection> reflections;
+    for (auto& shader: info.shaders)
+        reflections.push_back(shader->reflection());
+
+    ReflectedLayout result;
+    result.reflection = merge(reflections);
+
+    uint32_t sets = 0;
+    for (auto& binding: result.reflection.bindings)
+        sets = std::max(sets, binding.set + 1);
+
+    std::vector<std::vector<vk::DescriptorSetLayoutBinding>> bindings(sets);
+    for (auto& binding: result.reflection.bindings) {
+        if (binding.count == 0)
+            throw std::invalid_argument("runtime sized descriptor arrays need a hand-written layout");
+
+        auto type = binding.type;
+        bool dynamic = std::find(info.dynamic.begin(), info.dynamic.end(), std::pair(binding.set, binding.binding)) != info.dynamic.end();
+        if (dynamic && type == vk::DescriptorType::eUniformBuffer)
+            type = vk::DescriptorType::eUniformBufferDynamic;
+        else if (dynamic && type == vk::DescriptorType::eStorageBuffer)
+            type = vk::DescriptorType::eStorageBufferDynamic;
+        else if (dynamic)
+            throw std::invalid_argument(binding.name + " is not a buffer and can't be dynamic");
+
+        bindings[binding.set].push_back({ binding.binding, type, binding.count, binding.stages, nullptr });
+    }
+
+    for (auto& set: bindings)
+        result.descriptorLayouts.push_back(descriptorLayout(set));
+
+    result.pipelineLayout = pipelineLayout(result.descriptorLayouts, result.reflection.pushConstants);
+    return result;
+}
+
+size_t LayoutCache_t::purge() {
+    size_t count = std::erase_if(_pipelineLayouts, [](auto& item) {
+            return item.second.pipelineLayout.use_count() == 1;
+            });
+
+    // Pipeline entries go first, they may hold the last other reference to a set layout
+    count += std::erase_if(_descriptorLayouts, [](auto& item) {
+            return item.second.use_count() == 1;
+            });
+
+    return count;
+}
+
+size_t LayoutCache_t::size() {
+    return _descriptorLayouts.size() + _pipelineLayouts.size();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/shader.hpp>
+#include <hdvw/reflection.hpp>
+#include <hdvw/descriptorlayout.hpp>
+#include <hdvw/pipelinelayout.hpp>
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace hd {
+    struct LayoutCacheCreateInfo {
+        Device device;
+    };
+
+    struct ReflectedLayoutInfo {
+        std::vector<Shader> shaders;
+        // (set, binding) of buffers bound with dynamic offsets, SPIR-V can't tell them apart
+        std::vector<std::pair<uint32_t, uint32_t>> dynamic = {};
+    };
+
+    struct ReflectedLayout {
+        ShaderReflection reflection;
+        // One per set up to the highest one used, unused sets get an empty layout
+        std::vector<DescriptorLayout> descriptorLayouts;
+        PipelineLayout pipelineLayout;
+    };
+
+    class LayoutCache_t;
+    typedef std::shared_ptr<LayoutCache_t> LayoutCache;
+
+    // Identical descriptor and pipeline layouts are created once and shared.
+    // Entries stay alive while cached, purge() drops the ones nobody else holds.
+    class LayoutCache_t {
+        private:
+            typedef std::tuple<uint32_t, vk::DescriptorType, uint32_t, uint32_t, std::vector<uint64_t>> BindingKey;
+            typedef std::tuple<uint32_t, std::vector<BindingKey>> DescriptorKey;
+            typedef std::tuple<std::vector<uint64_t>, std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>> PipelineKey;
+
+            // Holds its set layouts so their handles can't be reused by another key
+            struct PipelineEntry {
+                std::vector<DescriptorLayout> descriptorLayouts;
+                PipelineLayout pipelineLayout;
+            };
+
+            Device _device;
+
+            std::map<DescriptorKey, DescriptorLayout> _descriptorLayouts;
+            std::map<PipelineKey, PipelineEntry> _pipelineLayouts;
+
+        public:
+            static LayoutCache conjure(LayoutCacheCreateInfo ci) {
+                return std::make_shared<LayoutCache_t>(ci);
+            }
+
+            LayoutCache_t(LayoutCacheCreateInfo ci);
+
+            // The order of bindings doesn't matter
+            DescriptorLayout descriptorLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings,
+                    vk::DescriptorSetLayoutCreateFlags flags = vk::DescriptorSetLayoutCreateFlags{0});
+
+            PipelineLayout pipelineLayout(const std::vector<DescriptorLayout>& descriptorLayouts,
+                    const std::vector<vk::PushConstantRange>& pushConstants = {});
+
+            // Merges the reflection of every shader and builds the layouts from it
+            ReflectedLayout reflect(ReflectedLayoutInfo info);
+
+            size_t purge();
+
+            size_t size();
+    };
+}
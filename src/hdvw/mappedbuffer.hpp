@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/allocator.hpp>
+#include <hdvw/buffer.hpp>
+
+#include <memory>
+#include <span>
+
+namespace hd {
+    template<class Data>
+    struct MappedBufferCreateInfo {
+        Allocator allocator;
+        uint64_t count = 1;
+        vk::BufferUsageFlags usage;
+        VmaMemoryUsage memoryUsage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    };
+
+    template<class Data>
+    class MappedBuffer_t;
+
+    template<class Data>
+    using MappedBuffer = std::shared_ptr<MappedBuffer_t<Data>>;
+
+    // Stays mapped for its whole lifetime, writes are plain stores followed by flush()
+    template<class Data>
+    class MappedBuffer_t {
+        private:
+            Buffer _buffer;
+            std::span<Data> _data;
+
+        public:
+            static MappedBuffer<Data> conjure(MappedBufferCreateInfo<Data> ci) {
+                return std::make_shared<MappedBuffer_t>(ci);
+            }
+
+            MappedBuffer_t(MappedBufferCreateInfo<Data> ci) {
+                _buffer = Buffer_t::conjure({
+                        .allocator = ci.allocator,
+                        .size = sizeof(Data) * ci.count,
+                        .bufferUsage = ci.usage,
+                        .memoryUsage = ci.memoryUsage,
+                        .mapped = true,
+                        });
+
+                _data = _buffer->span<Data>();
+            }
+
+            std::span<Data> data() {
+                return _data;
+            }
+
+            Data& operator[](uint64_t index) {
+                return _data[index];
+            }
+
+            void flush() {
+                _buffer->flush();
+            }
+
+            vk::DeviceSize size() {
+                return _buffer->size();
+            }
+
+            uint64_t count() {
+                return _data.size();
+            }
+
+            vk::Buffer raw() {
+                return _buffer->raw();
+            }
+
+            VmaAllocation memory() {
+                return _buffer->memory();
+            }
+    };
+}
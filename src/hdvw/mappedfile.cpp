@@ -0,0 +1,71 @@
+#include <hdvw/mappedfile.hpp>
+using namespace hd;
+
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile_t::MappedFile_t(MappedFileCreateInfo ci) {
+#ifdef _WIN32
+    std::ifstream file(ci.filename, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error(std::string("failed to open ") + ci.filename);
+
+    _size = (size_t) file.tellg();
+    _fallback.resize(_size);
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(_fallback.data()), _size);
+    _data = _fallback.data();
+#else
+    int fd = open(ci.filename, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(std::string("failed to open ") + ci.filename);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error(std::string("failed to stat ") + ci.filename);
+    }
+
+    _size = (size_t) info.st_size;
+    if (_size == 0) {
+        close(fd);
+        return;
+    }
+
+    void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        throw std::runtime_error(std::string("failed to map ") + ci.filename);
+
+    // Everything is read front to back into staging memory exactly once
+    madvise(data, _size, MADV_SEQUENTIAL);
+    madvise(data, _size, MADV_WILLNEED);
+    _data = static_cast<const std::byte*>(data);
+#endif
+}
+
+std::span<const std::byte> MappedFile_t::data() {
+    return { _data, _size };
+}
+
+size_t MappedFile_t::size() {
+    return _size;
+}
+
+MappedFile_t::~MappedFile_t() {
+#ifndef _WIN32
+    if (_data != nullptr)
+        munmap(const_cast<std::byte*>(_data), _size);
+#endif
+}
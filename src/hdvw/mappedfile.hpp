@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace hd {
+    struct MappedFileCreateInfo {
+        const char* filename;
+    };
+
+    class MappedFile_t;
+    typedef std::shared_ptr<MappedFile_t> MappedFile;
+
+    // Read-only view of a whole file. The pages come straight from the page cache,
+    // platforms without mmap read the file into memory instead.
+    class MappedFile_t {
+        private:
+            const std::byte* _data = nullptr;
+            size_t _size = 0;
+            std::vector<std::byte> _fallback;
+
+        public:
+            static MappedFile conjure(MappedFileCreateInfo ci) {
+                return std::make_shared<MappedFile_t>(ci);
+            }
+
+            MappedFile_t(MappedFileCreateInfo ci);
+
+            std::span<const std::byte> data();
+
+            size_t size();
+
+            ~MappedFile_t();
+    };
+}
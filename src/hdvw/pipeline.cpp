@@ -1,23 +1,23 @@
 #include <hdvw/pipeline.hpp>
 using namespace hd;
 
-DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
-    _device = ci.device->raw();
+#include <stdexcept>
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+DefaultPipelineState::DefaultPipelineState(const DefaultPipelineCreateInfo& ci) {
+    if (ci.extendedDynamicState && !ci.device->extensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+        throw std::invalid_argument("Extended dynamic state needs " VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+
+    bindingDescription = Vertex::getBindingDescription();
+    attributeDescriptions = Vertex::getAttributeDescriptions();
 
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
     vertexInputInfo.vertexBindingDescriptionCount = 1;
     vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
     vertexInputInfo.vertexAttributeDescriptionCount = attributeDescriptions.size();
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
-    vk::PipelineInputAssemblyStateCreateInfo inputAssembly = {};
-    inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
+    inputAssembly.topology = ci.topology;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    vk::Viewport viewport = {};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
     viewport.width = ci.extent.width;
@@ -25,17 +25,15 @@ DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
-    vk::Rect2D scissor = {};
     scissor.offset = vk::Offset2D{ 0, 0 };
     scissor.extent = ci.extent;
 
-    vk::PipelineViewportStateCreateInfo viewportState = {};
+    // Dynamic viewports only need the count
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
+    viewportState.pViewports = ci.dynamicViewport ? nullptr : &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    viewportState.pScissors = ci.dynamicViewport ? nullptr : &scissor;
 
-    vk::PipelineRasterizationStateCreateInfo rasterizer = {};
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
     rasterizer.lineWidth = 1.0f;
@@ -48,7 +46,6 @@ DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
     rasterizer.depthBiasClamp = 0.0f;
     rasterizer.depthBiasSlopeFactor = 0.0f;
 
-    vk::PipelineMultisampleStateCreateInfo multisampling = {};
     multisampling.sampleShadingEnable = VK_FALSE;
     multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
 
@@ -57,7 +54,6 @@ DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
     multisampling.alphaToCoverageEnable = VK_FALSE;
     multisampling.alphaToOneEnable = VK_FALSE;
 
-    vk::PipelineDepthStencilStateCreateInfo depthStencil = {};
     depthStencil.depthCompareOp = vk::CompareOp::eLess;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.stencilTestEnable = VK_FALSE;
@@ -69,7 +65,6 @@ DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
         depthStencil.depthWriteEnable = VK_FALSE;
     }
 
-    vk::PipelineColorBlendAttachmentState colorBlendAttachment = {};
     colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
         | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
     colorBlendAttachment.blendEnable = VK_FALSE;
@@ -81,7 +76,6 @@ DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
     colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
     colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
 
-    vk::PipelineColorBlendStateCreateInfo colorBlending = {};
     colorBlending.logicOpEnable = VK_FALSE;
     colorBlending.logicOp = vk::LogicOp::eCopy;
     colorBlending.attachmentCount = 1;
@@ -91,16 +85,21 @@ DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
     colorBlending.blendConstants[2] = 0.0f;
     colorBlending.blendConstants[3] = 0.0f;
 
-    /* vk::DynamicState dynamicStates[] = { */
-    /*     vk::DynamicState::eViewport, */
-    /*     vk::DynamicState::eLineWidth, */
-    /* }; */
+    if (ci.dynamicViewport) {
+        dynamicStates.push_back(vk::DynamicState::eViewport);
+        dynamicStates.push_back(vk::DynamicState::eScissor);
+    }
+    if (ci.extendedDynamicState) {
+        dynamicStates.push_back(vk::DynamicState::eCullModeEXT);
+        dynamicStates.push_back(vk::DynamicState::eFrontFaceEXT);
+        dynamicStates.push_back(vk::DynamicState::eDepthTestEnableEXT);
+        dynamicStates.push_back(vk::DynamicState::eDepthWriteEnableEXT);
+        dynamicStates.push_back(vk::DynamicState::ePrimitiveTopologyEXT);
+    }
 
-    /* vk::PipelineDynamicStateCreateInfo dynamicState{}; */
-    /* dynamicState.dynamicStateCount = 2; */
-    /* dynamicState.pDynamicStates = dynamicStates; */
+    dynamicState.dynamicStateCount = dynamicStates.size();
+    dynamicState.pDynamicStates = dynamicStates.data();
 
-    vk::GraphicsPipelineCreateInfo pipelineInfo = {};
     pipelineInfo.stageCount = ci.shaderInfo.size();
     pipelineInfo.pStages = ci.shaderInfo.data();
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -110,24 +109,120 @@ DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    /* pipelineInfo.pDynamicState = &dynamicState; */
-    pipelineInfo.layout = ci.pipelineLayout->raw();
-    pipelineInfo.renderPass = ci.renderPass->raw();
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = ci.pipelineLayout != nullptr ? ci.pipelineLayout->raw() : nullptr;
+    pipelineInfo.renderPass = ci.renderPass != nullptr ? ci.renderPass->raw() : nullptr;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = nullptr;
     pipelineInfo.basePipelineIndex = -1;
+}
 
-    auto res = _device.createGraphicsPipeline(nullptr, pipelineInfo);
+DefaultPipeline_t::DefaultPipeline_t(DefaultPipelineCreateInfo ci) {
+    _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
+
+    DefaultPipelineState state(ci);
+
+    vk::PipelineCache cache = ci.pipelineCache != nullptr ? ci.pipelineCache->raw() : nullptr;
+
+    auto res = _device.createGraphicsPipeline(cache, state.pipelineInfo);
     if (res.result != vk::Result::eSuccess)
         throw std::runtime_error("Failed to create a pipeline");
 
     _pipeline = res.value;
 }
 
+DefaultPipeline_t::DefaultPipeline_t(Device device, vk::Pipeline pipeline) {
+    _device = device->raw();
+    _deletionQueue = device->deletionQueue();
+    _pipeline = pipeline;
+}
+
+std::vector<Pipeline> DefaultPipeline_t::batch(const std::vector<DefaultPipelineCreateInfo>& cis) {
+    if (cis.empty())
+        return {};
+
+    std::vector<std::unique_ptr<DefaultPipelineState>> states;
+    std::vector<vk::GraphicsPipelineCreateInfo> infos;
+    for (auto& ci: cis) {
+        states.push_back(std::make_unique<DefaultPipelineState>(ci));
+        infos.push_back(states.back()->pipelineInfo);
+    }
+
+    auto device = cis.front().device;
+    auto pipelineCache = cis.front().pipelineCache;
+    vk::PipelineCache cache = pipelineCache != nullptr ? pipelineCache->raw() : nullptr;
+
+    auto res = device->raw().createGraphicsPipelines(cache, infos);
+    if (res.result != vk::Result::eSuccess) {
+        for (auto pipeline: res.value)
+            if (pipeline)
+                device->raw().destroy(pipeline);
+        throw std::runtime_error("Failed to create a batch of pipelines");
+    }
+
+    std::vector<Pipeline> pipelines;
+    for (auto pipeline: res.value)
+        pipelines.push_back(std::make_shared<DefaultPipeline_t>(device, pipeline));
+
+    return pipelines;
+}
+
 vk::Pipeline DefaultPipeline_t::raw() {
     return _pipeline;
 }
 
 DefaultPipeline_t::~DefaultPipeline_t() {
-    _device.destroy(_pipeline);
+    _deletionQueue->destroy(_device, _pipeline);
+}
+
+ComputePipeline_t::ComputePipeline_t(ComputePipelineCreateInfo ci) {
+    _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
+    _pipelineLayout = ci.pipelineLayout;
+    _localSize = specializedLocalSize(ci.shader->reflection(), ci.specialization != nullptr ? ci.specialization->info() : nullptr);
+
+    if (ci.shader->reflection().stages != vk::ShaderStageFlags(vk::ShaderStageFlagBits::eCompute))
+        throw std::invalid_argument("Compute pipelines need a compute shader");
+
+    vk::ComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.stage = ci.specialization != nullptr ? ci.shader->info(ci.specialization) : ci.shader->info();
+    pipelineInfo.layout = ci.pipelineLayout->raw();
+    pipelineInfo.basePipelineHandle = nullptr;
+    pipelineInfo.basePipelineIndex = -1;
+
+    vk::PipelineCache cache = ci.pipelineCache != nullptr ? ci.pipelineCache->raw() : nullptr;
+
+    auto res = _device.createComputePipeline(cache, pipelineInfo);
+    if (res.result != vk::Result::eSuccess)
+        throw std::runtime_error("Failed to create a compute pipeline");
+
+    _pipeline = res.value;
+}
+
+vk::Pipeline ComputePipeline_t::raw() {
+    return _pipeline;
+}
+
+PipelineLayout ComputePipeline_t::layout() {
+    return _pipelineLayout;
+}
+
+std::array<uint32_t, 3> ComputePipeline_t::localSize() {
+    return _localSize;
+}
+
+void ComputePipeline_t::bind(CommandBuffer cmd) {
+    cmd->raw().bindPipeline(vk::PipelineBindPoint::eCompute, _pipeline);
+}
+
+void ComputePipeline_t::dispatch(CommandBuffer cmd, uint32_t x, uint32_t y, uint32_t z) {
+    cmd->dispatch(
+            (x + _localSize[0] - 1) / _localSize[0],
+            (y + _localSize[1] - 1) / _localSize[1],
+            (z + _localSize[2] - 1) / _localSize[2]);
+}
+
+ComputePipeline_t::~ComputePipeline_t() {
+    _deletionQueue->destroy(_device, _pipeline);
 }
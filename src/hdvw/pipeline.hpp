@@ -4,9 +4,14 @@
 
 #include <hdvw/device.hpp>
 #include <hdvw/pipelinelayout.hpp>
+#include <hdvw/pipelinecache.hpp>
 #include <hdvw/renderpass.hpp>
+#include <hdvw/commandbuffer.hpp>
+#include <hdvw/shader.hpp>
+#include <hdvw/specialization.hpp>
 #include <hdvw/vertex.hpp>
 
+#include <array>
 #include <vector>
 #include <memory>
 
@@ -23,27 +28,113 @@ namespace hd {
         RenderPass renderPass;
         Device device;
         std::vector<vk::PipelineShaderStageCreateInfo> shaderInfo;
-        vk::Extent2D extent;
+        // Owners of the modules in shaderInfo, needed by PipelineCompiler_t to keep them alive
+        std::vector<Shader> shaders = {};
+        // Owners of any specialization info in shaderInfo, for the same reason
+        std::vector<Specialization> specializations = {};
+        // Only baked in when the viewport isn't dynamic
+        vk::Extent2D extent = {};
+        bool dynamicViewport = true;
         vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
         vk::FrontFace frontFace = vk::FrontFace::eClockwise;
         vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+        vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
         bool checkDepth = true;
+        // Cull mode, front face, depth test and write and topology are then set with
+        // CommandBuffer_t::setDynamicState, the values above only pick the topology class.
+        // Needs VK_EXT_extended_dynamic_state enabled on the device.
+        bool extendedDynamicState = false;
+        PipelineCache pipelineCache = nullptr;
+    };
+
+    // Every piece of fixed function state DefaultPipeline_t uses, with the pointers between
+    // them already set. Shader stages point into ci, which has to outlive the state.
+    struct DefaultPipelineState {
+        vk::VertexInputBindingDescription bindingDescription;
+        std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions;
+        vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
+        vk::PipelineInputAssemblyStateCreateInfo inputAssembly = {};
+        vk::Viewport viewport = {};
+        vk::Rect2D scissor = {};
+        vk::PipelineViewportStateCreateInfo viewportState = {};
+        vk::PipelineRasterizationStateCreateInfo rasterizer = {};
+        vk::PipelineMultisampleStateCreateInfo multisampling = {};
+        vk::PipelineDepthStencilStateCreateInfo depthStencil = {};
+        vk::PipelineColorBlendAttachmentState colorBlendAttachment = {};
+        vk::PipelineColorBlendStateCreateInfo colorBlending = {};
+        std::vector<vk::DynamicState> dynamicStates;
+        vk::PipelineDynamicStateCreateInfo dynamicState = {};
+        vk::GraphicsPipelineCreateInfo pipelineInfo = {};
+
+        DefaultPipelineState(const DefaultPipelineCreateInfo& ci);
+
+        DefaultPipelineState(const DefaultPipelineState&) = delete;
+
+        DefaultPipelineState& operator=(const DefaultPipelineState&) = delete;
     };
 
     class DefaultPipeline_t : public Pipeline_t {
         private:
             vk::Pipeline _pipeline;
             vk::Device _device;
+            DeletionQueue _deletionQueue;
 
         public:
             static Pipeline conjure(DefaultPipelineCreateInfo ci) {
                 return std::static_pointer_cast<Pipeline_t>(std::make_shared<DefaultPipeline_t>(ci));
             }
 
+            // Creates them all with one call, they have to share a device and pipeline cache
+            static std::vector<Pipeline> batch(const std::vector<DefaultPipelineCreateInfo>& cis);
+
             DefaultPipeline_t(DefaultPipelineCreateInfo ci);
 
+            // Takes ownership of a pipeline created elsewhere
+            DefaultPipeline_t(Device device, vk::Pipeline pipeline);
+
             vk::Pipeline raw();
 
             ~DefaultPipeline_t();
     };
+
+    struct ComputePipelineCreateInfo {
+        Device device;
+        PipelineLayout pipelineLayout;
+        Shader shader;
+        Specialization specialization = nullptr;
+        PipelineCache pipelineCache = nullptr;
+    };
+
+    class ComputePipeline_t;
+    typedef std::shared_ptr<ComputePipeline_t> ComputePipeline;
+
+    class ComputePipeline_t : public Pipeline_t {
+        private:
+            vk::Pipeline _pipeline;
+            vk::Device _device;
+            DeletionQueue _deletionQueue;
+            PipelineLayout _pipelineLayout;
+            std::array<uint32_t, 3> _localSize;
+
+        public:
+            static ComputePipeline conjure(ComputePipelineCreateInfo ci) {
+                return std::make_shared<ComputePipeline_t>(ci);
+            }
+
+            ComputePipeline_t(ComputePipelineCreateInfo ci);
+
+            vk::Pipeline raw();
+
+            PipelineLayout layout();
+
+            // With the specialization applied, dispatch() divides by it
+            std::array<uint32_t, 3> localSize();
+
+            void bind(CommandBuffer cmd);
+
+            // Enough workgroups to cover x * y * z invocations, the shader checks the edges
+            void dispatch(CommandBuffer cmd, uint32_t x, uint32_t y = 1, uint32_t z = 1);
+
+            ~ComputePipeline_t();
+    };
 }
@@ -0,0 +1,113 @@
+#include <hdvw/pipelinecache.hpp>
+using namespace hd;
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+std::vector<char> PipelineCache_t::read() {
+    std::ifstream file(_filename, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return {};
+
+    size_t fileSize = (size_t) file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+
+    return buffer;
+}
+
+// Drivers should reject foreign data themselves, not all of them do
+bool PipelineCache_t::validate(const std::vector<char>& data) {
+    struct Header {
+        uint32_t length;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t uuid[VK_UUID_SIZE];
+    } header;
+
+    if (data.size() < sizeof(header))
+        return false;
+    memcpy(&header, data.data(), sizeof(header));
+
+    auto properties = _physicalDevice.getProperties();
+
+    return header.length >= sizeof(header)
+        && header.version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && memcmp(header.uuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+PipelineCache_t::PipelineCache_t(PipelineCacheCreateInfo ci) {
+    _device = ci.device->raw();
+    _physicalDevice = ci.device->physical();
+    _filename = ci.filename;
+
+    std::vector<char> data;
+    if (!_filename.empty()) {
+        data = read();
+        if (!validate(data))
+            data.clear();
+    }
+
+    vk::PipelineCacheCreateInfo pci = {};
+    pci.initialDataSize = data.size();
+    pci.pInitialData = data.data();
+
+    try {
+        _cache = _device.createPipelineCache(pci);
+        _loaded = !data.empty();
+    } catch (vk::SystemError& e) {
+        if (data.empty())
+            throw;
+
+        // Passed the header check and was still refused, start over
+        pci.initialDataSize = 0;
+        pci.pInitialData = nullptr;
+        _cache = _device.createPipelineCache(pci);
+    }
+}
+
+// Written next to the target first, a crash mid-write must not leave a truncated cache
+void PipelineCache_t::save() {
+    if (_filename.empty())
+        return;
+
+    auto data = _device.getPipelineCacheData(_cache);
+    auto temporary = _filename + ".tmp";
+
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open " + temporary + " for writing");
+
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    file.close();
+    if (!file)
+        throw std::runtime_error("failed to write " + temporary);
+
+    std::filesystem::rename(temporary, _filename);
+}
+
+bool PipelineCache_t::loaded() {
+    return _loaded;
+}
+
+vk::PipelineCache PipelineCache_t::raw() {
+    return _cache;
+}
+
+// Pipelines made from the cache do not reference it, so it goes right away
+PipelineCache_t::~PipelineCache_t() {
+    try {
+        save();
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+
+    _device.destroy(_cache);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hd {
+    struct PipelineCacheCreateInfo {
+        Device device;
+        // Empty keeps the cache in memory only
+        std::string filename = "";
+    };
+
+    class PipelineCache_t;
+    typedef std::shared_ptr<PipelineCache_t> PipelineCache;
+
+    // Starts from the file when its header matches this device and driver, anything
+    // else is ignored and the cache starts empty. Saved again on destruction.
+    class PipelineCache_t {
+        private:
+            vk::PipelineCache _cache;
+            vk::Device _device;
+            vk::PhysicalDevice _physicalDevice;
+            std::string _filename;
+            bool _loaded = false;
+
+            std::vector<char> read();
+
+            bool validate(const std::vector<char>& data);
+
+        public:
+            static PipelineCache conjure(PipelineCacheCreateInfo ci) {
+                return std::make_shared<PipelineCache_t>(ci);
+            }
+
+            PipelineCache_t(PipelineCacheCreateInfo ci);
+
+            void save();
+
+            // Whether the initial data came from disk
+            bool loaded();
+
+            vk::PipelineCache raw();
+
+            ~PipelineCache_t();
+    };
+}
@@ -0,0 +1,195 @@
+#include <hdvw/pipelinecompiler.hpp>
+using namespace hd;
+
+#include <hdvw/hash.hpp>
+#include <hdvw/specialization.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+PipelineCompiler_t::PipelineCompiler_t(PipelineCompilerCreateInfo ci) {
+    _threadPool = ci.threadPool != nullptr ? ci.threadPool : ThreadPool_t::conjure({});
+    _batchSize = std::max(ci.batchSize, 1u);
+}
+
+// Field by field, the create infos have padding and pointers that mean nothing here
+uint64_t PipelineCompiler_t::hash(const DefaultPipelineCreateInfo& ci) {
+    uint64_t hash = FNV_OFFSET;
+
+    hash = fnv1a(ci.pipelineLayout != nullptr ? (uint64_t) static_cast<VkPipelineLayout>(ci.pipelineLayout->raw()) : 0, hash);
+    hash = fnv1a(ci.renderPass != nullptr ? (uint64_t) static_cast<VkRenderPass>(ci.renderPass->raw()) : 0, hash);
+    hash = fnv1a((uint64_t) static_cast<VkDevice>(ci.device->raw()), hash);
+
+    for (auto& stage: ci.shaderInfo) {
+        hash = fnv1a(static_cast<uint32_t>(stage.stage), hash);
+        hash = fnv1a((uint64_t) static_cast<VkShaderModule>(stage.module), hash);
+        hash = fnv1a(std::as_bytes(std::span(stage.pName, std::strlen(stage.pName))), hash);
+        hash = hd::hash(stage.pSpecializationInfo, hash);
+    }
+
+    if (!ci.dynamicViewport) {
+        hash = fnv1a(ci.extent.width, hash);
+        hash = fnv1a(ci.extent.height, hash);
+    }
+
+    hash = fnv1a(ci.dynamicViewport, hash);
+    hash = fnv1a(static_cast<uint32_t>(ci.cullMode), hash);
+    hash = fnv1a(ci.frontFace, hash);
+    hash = fnv1a(ci.polygonMode, hash);
+    hash = fnv1a(ci.topology, hash);
+    hash = fnv1a(ci.checkDepth, hash);
+    hash = fnv1a(ci.extendedDynamicState, hash);
+    hash = fnv1a(ci.pipelineCache != nullptr ? (uint64_t) static_cast<VkPipelineCache>(ci.pipelineCache->raw()) : 0, hash);
+
+    return hash;
+}
+
+bool PipelineCompiler_t::equal(const DefaultPipelineCreateInfo& a, const DefaultPipelineCreateInfo& b) {
+    if (a.pipelineLayout != b.pipelineLayout || a.renderPass != b.renderPass || a.pipelineCache != b.pipelineCache
+            || a.device->raw() != b.device->raw() || a.shaderInfo.size() != b.shaderInfo.size())
+        return false;
+
+    for (size_t iter = 0; iter < a.shaderInfo.size(); iter++) {
+        auto& stageA = a.shaderInfo[iter];
+        auto& stageB = b.shaderInfo[iter];
+        if (stageA.stage != stageB.stage || stageA.module != stageB.module || std::strcmp(stageA.pName, stageB.pName) != 0
+                || !hd::equal(stageA.pSpecializationInfo, stageB.pSpecializationInfo))
+            return false;
+    }
+
+    if (!a.dynamicViewport && a.extent != b.extent)
+        return false;
+
+    return a.dynamicViewport == b.dynamicViewport
+        && a.cullMode == b.cullMode
+        && a.frontFace == b.frontFace
+        && a.polygonMode == b.polygonMode
+        && a.topology == b.topology
+        && a.checkDepth == b.checkDepth
+        && a.extendedDynamicState == b.extendedDynamicState;
+}
+
+std::shared_future<Pipeline> PipelineCompiler_t::compile(DefaultPipelineCreateInfo ci) {
+    return compile(std::vector<DefaultPipelineCreateInfo>{ ci }).front();
+}
+
+std::vector<std::shared_future<Pipeline>> PipelineCompiler_t::compile(const std::vector<DefaultPipelineCreateInfo>& cis) {
+    std::vector<std::shared_future<Pipeline>> futures;
+    std::vector<DefaultPipelineCreateInfo> missing;
+    std::vector<std::shared_ptr<std::promise<Pipeline>>> promises;
+
+    for (auto& ci: cis)
+        for (auto& stage: ci.shaderInfo) {
+            if (std::none_of(ci.shaders.begin(), ci.shaders.end(), [&](auto& shader) { return shader->info().module == stage.module; }))
+                throw std::invalid_argument("A shader stage has no owning Shader in the pipeline description");
+
+            if (stage.pSpecializationInfo != nullptr && std::none_of(ci.specializations.begin(), ci.specializations.end(),
+                        [&](auto& specialization) { return specialization != nullptr && specialization->info() == stage.pSpecializationInfo; }))
+                throw std::invalid_argument("A shader stage has no owning Specialization in the pipeline description");
+        }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto& ci: cis) {
+            auto& entries = _pipelines[hash(ci)];
+            auto entry = std::find_if(entries.begin(), entries.end(), [&](auto& entry) {
+                    return equal(entry.info, ci);
+                    });
+
+            if (entry == entries.end()) {
+                auto promise = std::make_shared<std::promise<Pipeline>>();
+                entries.push_back({ promise->get_future().share(), ci });
+                entry = entries.end() - 1;
+
+                missing.push_back(ci);
+                promises.push_back(promise);
+            }
+
+            futures.push_back(entry->pipeline);
+        }
+    }
+
+    // One call creates a whole batch with the device and cache of its first description
+    std::vector<size_t> order(missing.size());
+    for (size_t iter = 0; iter < order.size(); iter++)
+        order[iter] = iter;
+    auto target = [&](size_t index) {
+        auto& ci = missing[index];
+        return std::make_pair((uint64_t) static_cast<VkDevice>(ci.device->raw()),
+                ci.pipelineCache != nullptr ? (uint64_t) static_cast<VkPipelineCache>(ci.pipelineCache->raw()) : 0);
+    };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return target(a) < target(b);
+            });
+
+    // Small lists still reach every worker, big ones are capped at the batch size
+    size_t workers = std::max(_threadPool->size(), 1u);
+    size_t batch = std::clamp<size_t>((missing.size() + workers - 1) / workers, 1, _batchSize);
+
+    for (size_t start = 0; start < order.size();) {
+        size_t end = start + 1;
+        while (end < order.size() && end - start < batch && target(order[end]) == target(order[start]))
+            end++;
+
+        std::vector<DefaultPipelineCreateInfo> batchInfos;
+        std::vector<std::shared_ptr<std::promise<Pipeline>>> batchPromises;
+        for (size_t iter = start; iter < end; iter++) {
+            batchInfos.push_back(missing[order[iter]]);
+            batchPromises.push_back(promises[order[iter]]);
+        }
+        start = end;
+
+        _threadPool->submit([batchInfos, batchPromises]() {
+                try {
+                    auto pipelines = DefaultPipeline_t::batch(batchInfos);
+                    for (size_t iter = 0; iter < pipelines.size(); iter++)
+                        batchPromises[iter]->set_value(pipelines[iter]);
+                } catch (...) {
+                    for (auto& promise: batchPromises)
+                        promise->set_exception(std::current_exception());
+                }
+                });
+    }
+
+    return futures;
+}
+
+void PipelineCompiler_t::warmUp(const std::vector<DefaultPipelineCreateInfo>& cis) {
+    for (auto& future: compile(cis))
+        future.get();
+}
+
+size_t PipelineCompiler_t::purge() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    size_t purged = 0;
+    for (auto& [hash, entries]: _pipelines)
+        purged += std::erase_if(entries, [](auto& entry) {
+                auto& future = entry.pipeline;
+                if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    return false;
+
+                try {
+                    return future.get().use_count() == 1;
+                } catch (...) {
+                    return true;
+                }
+                });
+
+    std::erase_if(_pipelines, [](auto& item) {
+            return item.second.empty();
+            });
+
+    return purged;
+}
+
+size_t PipelineCompiler_t::size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    size_t size = 0;
+    for (auto& [hash, entries]: _pipelines)
+        size += entries.size();
+    return size;
+}
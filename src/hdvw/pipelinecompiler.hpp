@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/pipeline.hpp>
+#include <hdvw/threadpool.hpp>
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace hd {
+    struct PipelineCompilerCreateInfo {
+        // A pool using every hardware thread is made when there is none
+        ThreadPool threadPool = nullptr;
+        // Most pipelines handed to one createGraphicsPipelines call
+        uint32_t batchSize = 8;
+    };
+
+    class PipelineCompiler_t;
+    typedef std::shared_ptr<PipelineCompiler_t> PipelineCompiler;
+
+    // Compiles DefaultPipeline_t descriptions on worker threads and hands out futures.
+    // Descriptions with the same state share one pipeline, which stays cached until purge().
+    // State is compared by handle values, so every entry keeps its description and with it
+    // the render pass, layout, shaders and specializations, which also keeps the handles from
+    // being reused. A failed compile stays cached with its exception.
+    class PipelineCompiler_t {
+        private:
+            ThreadPool _threadPool;
+            uint32_t _batchSize;
+
+            struct Entry {
+                std::shared_future<Pipeline> pipeline;
+                DefaultPipelineCreateInfo info;
+            };
+
+            std::mutex _mutex;
+            // Entries sharing a hash are told apart by equal()
+            std::map<uint64_t, std::vector<Entry>> _pipelines;
+
+        public:
+            static PipelineCompiler conjure(PipelineCompilerCreateInfo ci) {
+                return std::make_shared<PipelineCompiler_t>(ci);
+            }
+
+            PipelineCompiler_t(PipelineCompilerCreateInfo ci);
+
+            static uint64_t hash(const DefaultPipelineCreateInfo& ci);
+
+            // Whether two descriptions build the same pipeline into the same cache
+            static bool equal(const DefaultPipelineCreateInfo& a, const DefaultPipelineCreateInfo& b);
+
+            // Every module in ci.shaderInfo has to come from one of ci.shaders, and every
+            // specialization info from one of ci.specializations
+            std::shared_future<Pipeline> compile(DefaultPipelineCreateInfo ci);
+
+            // Misses are spread over the workers in batches, the futures keep the order of cis
+            std::vector<std::shared_future<Pipeline>> compile(const std::vector<DefaultPipelineCreateInfo>& cis);
+
+            // Compiles the list and blocks until all of it is done, rethrowing the first failure
+            void warmUp(const std::vector<DefaultPipelineCreateInfo>& cis);
+
+            // Drops finished pipelines nobody else holds
+            size_t purge();
+
+            size_t size();
+    };
+}
@@ -3,6 +3,7 @@ using namespace hd;
 
 PipelineLayout_t::PipelineLayout_t(PipelineLayoutCreateInfo ci) {
     _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
 
     vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
     pipelineLayoutInfo.setLayoutCount = ci.descriptorLayouts.size();
@@ -18,5 +19,5 @@ vk::PipelineLayout PipelineLayout_t::raw() {
 }
 
 PipelineLayout_t::~PipelineLayout_t() {
-    _device.destroy(_pipelineLayout);
+    _deletionQueue->destroy(_device, _pipelineLayout);
 }
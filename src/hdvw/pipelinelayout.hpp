@@ -20,6 +20,7 @@ namespace hd {
     class PipelineLayout_t {
         private:
             vk::Device _device;
+            DeletionQueue _deletionQueue;
             vk::PipelineLayout _pipelineLayout;
 
         public:
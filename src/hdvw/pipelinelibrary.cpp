@@ -0,0 +1,247 @@
+#include <hdvw/pipelinelibrary.hpp>
+using namespace hd;
+
+#include <hdvw/hash.hpp>
+#include <hdvw/specialization.hpp>
+
+#include <chrono>
+#include <stdexcept>
+
+LinkedPipeline_t::LinkedPipeline_t(Device device, vk::Pipeline pipeline, std::future<vk::Pipeline> optimized) {
+    _device = device->raw();
+    _deletionQueue = device->deletionQueue();
+    _pipeline = pipeline;
+    _optimized = std::move(optimized);
+}
+
+vk::Pipeline LinkedPipeline_t::raw() {
+    if (_optimized.valid() && _optimized.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        // A failed optimized link keeps the fast one, which works just as well
+        try {
+            auto optimized = _optimized.get();
+            _deletionQueue->destroy(_device, _pipeline);
+            _pipeline = optimized;
+        } catch (const std::exception&) {}
+    }
+
+    return _pipeline;
+}
+
+bool LinkedPipeline_t::optimized() {
+    return !_optimized.valid();
+}
+
+LinkedPipeline_t::~LinkedPipeline_t() {
+    // Never bound, so it can go right away
+    if (_optimized.valid()) {
+        try {
+            _device.destroy(_optimized.get());
+        } catch (const std::exception&) {}
+    }
+
+    _deletionQueue->destroy(_device, _pipeline);
+}
+
+PipelineLibrary_t::Part::~Part() {
+    deletionQueue->destroy(device, pipeline);
+}
+
+PipelineLibrary_t::PipelineLibrary_t(PipelineLibraryCreateInfo ci) {
+    _device = ci.device;
+    _pipelineLayout = ci.pipelineLayout;
+    _renderPass = ci.renderPass;
+    _pipelineCache = ci.pipelineCache;
+    _threadPool = ci.threadPool;
+
+#ifdef VK_EXT_graphics_pipeline_library
+    _supported = _device->extensionEnabled(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+#endif
+
+    if (_supported && _threadPool == nullptr)
+        _threadPool = ThreadPool_t::conjure({ .threads = 1 });
+}
+
+static vk::PipelineShaderStageCreateInfo stageInfo(Shader shader, Specialization specialization) {
+    return specialization != nullptr ? shader->info(specialization) : shader->info();
+}
+
+DefaultPipelineCreateInfo PipelineLibrary_t::defaults(const PipelinePermutation& permutation,
+        std::vector<vk::PipelineShaderStageCreateInfo> shaderInfo, std::vector<Shader> shaders,
+        std::vector<Specialization> specializations) {
+    return {
+        .pipelineLayout = _pipelineLayout,
+        .renderPass = _renderPass,
+        .device = _device,
+        .shaderInfo = shaderInfo,
+        .shaders = shaders,
+        .specializations = specializations,
+        .cullMode = permutation.cullMode,
+        .frontFace = permutation.frontFace,
+        .polygonMode = permutation.polygonMode,
+        .topology = permutation.topology,
+        .checkDepth = permutation.checkDepth,
+        .pipelineCache = _pipelineCache,
+    };
+}
+
+#ifdef VK_EXT_graphics_pipeline_library
+std::shared_ptr<PipelineLibrary_t::Part> PipelineLibrary_t::part(vk::GraphicsPipelineLibraryFlagsEXT flags,
+        const PipelinePermutation& permutation) {
+    using Flag = vk::GraphicsPipelineLibraryFlagBitsEXT;
+
+    auto result = std::make_shared<Part>();
+    result->device = _device->raw();
+    result->deletionQueue = _device->deletionQueue();
+
+    std::vector<vk::PipelineShaderStageCreateInfo> shaderInfo;
+    if (flags & Flag::ePreRasterizationShaders) {
+        shaderInfo.push_back(stageInfo(permutation.vertex, permutation.vertexSpecialization));
+        result->shaders.push_back(permutation.vertex);
+        result->specializations.push_back(permutation.vertexSpecialization);
+    }
+    if (flags & Flag::eFragmentShader) {
+        shaderInfo.push_back(stageInfo(permutation.fragment, permutation.fragmentSpecialization));
+        result->shaders.push_back(permutation.fragment);
+        result->specializations.push_back(permutation.fragmentSpecialization);
+    }
+
+    auto ci = defaults(permutation, shaderInfo, result->shaders, result->specializations);
+    DefaultPipelineState state(ci);
+
+    // Each part only gets the state its subset owns
+    auto& info = state.pipelineInfo;
+    if (!(flags & Flag::eVertexInputInterface)) {
+        info.pVertexInputState = nullptr;
+        info.pInputAssemblyState = nullptr;
+    }
+    if (!(flags & Flag::ePreRasterizationShaders)) {
+        info.pViewportState = nullptr;
+        info.pRasterizationState = nullptr;
+    }
+    if (!(flags & Flag::eFragmentShader))
+        info.pDepthStencilState = nullptr;
+    if (!(flags & (Flag::eFragmentShader | Flag::eFragmentOutputInterface)))
+        info.pMultisampleState = nullptr;
+    if (!(flags & Flag::eFragmentOutputInterface))
+        info.pColorBlendState = nullptr;
+
+    vk::GraphicsPipelineLibraryCreateInfoEXT libraryInfo = {};
+    libraryInfo.flags = flags;
+
+    info.pNext = &libraryInfo;
+    info.flags = vk::PipelineCreateFlagBits::eLibraryKHR | vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
+
+    vk::PipelineCache cache = _pipelineCache != nullptr ? _pipelineCache->raw() : nullptr;
+
+    auto res = _device->raw().createGraphicsPipeline(cache, info);
+    if (res.result != vk::Result::eSuccess)
+        throw std::runtime_error("Failed to create a pipeline library part");
+
+    result->pipeline = res.value;
+    return result;
+}
+
+static vk::Pipeline linkParts(vk::Device device, vk::PipelineCache cache, vk::PipelineLayout layout,
+        const std::vector<vk::Pipeline>& libraries, vk::PipelineCreateFlags flags) {
+    vk::PipelineLibraryCreateInfoKHR libraryInfo = {};
+    libraryInfo.libraryCount = libraries.size();
+    libraryInfo.pLibraries = libraries.data();
+
+    vk::GraphicsPipelineCreateInfo info = {};
+    info.pNext = &libraryInfo;
+    info.flags = flags;
+    info.layout = layout;
+
+    auto res = device.createGraphicsPipeline(cache, info);
+    if (res.result != vk::Result::eSuccess)
+        throw std::runtime_error("Failed to link a pipeline");
+
+    return res.value;
+}
+#endif
+
+Pipeline PipelineLibrary_t::link(PipelinePermutation permutation) {
+    auto vertex = stageInfo(permutation.vertex, permutation.vertexSpecialization);
+    auto fragment = stageInfo(permutation.fragment, permutation.fragmentSpecialization);
+
+    PreRasterizationKey preRasterization = {
+        (uint64_t) static_cast<VkShaderModule>(vertex.module),
+        vertex.pName,
+        hd::hash(vertex.pSpecializationInfo, FNV_OFFSET),
+        static_cast<uint32_t>(permutation.cullMode),
+        permutation.frontFace,
+        permutation.polygonMode,
+    };
+
+    FragmentShaderKey fragmentShader = {
+        (uint64_t) static_cast<VkShaderModule>(fragment.module),
+        fragment.pName,
+        hd::hash(fragment.pSpecializationInfo, FNV_OFFSET),
+        permutation.checkDepth,
+    };
+
+    auto& linked = _pipelines[{ preRasterization, fragmentShader, permutation.topology }];
+    if (linked.pipeline != nullptr)
+        return linked.pipeline;
+
+    linked.vertex = permutation.vertex;
+    linked.fragment = permutation.fragment;
+    linked.vertexSpecialization = permutation.vertexSpecialization;
+    linked.fragmentSpecialization = permutation.fragmentSpecialization;
+    auto& pipeline = linked.pipeline;
+
+    if (!_supported) {
+        pipeline = DefaultPipeline_t::conjure(defaults(permutation, { vertex, fragment }, { permutation.vertex, permutation.fragment },
+                    { permutation.vertexSpecialization, permutation.fragmentSpecialization }));
+        return pipeline;
+    }
+
+#ifdef VK_EXT_graphics_pipeline_library
+    using Flag = vk::GraphicsPipelineLibraryFlagBitsEXT;
+
+    auto& vertexInputPart = _vertexInput[permutation.topology];
+    if (vertexInputPart == nullptr)
+        vertexInputPart = part(Flag::eVertexInputInterface, permutation);
+
+    auto& preRasterizationPart = _preRasterization[preRasterization];
+    if (preRasterizationPart == nullptr)
+        preRasterizationPart = part(Flag::ePreRasterizationShaders, permutation);
+
+    auto& fragmentShaderPart = _fragmentShader[fragmentShader];
+    if (fragmentShaderPart == nullptr)
+        fragmentShaderPart = part(Flag::eFragmentShader, permutation);
+
+    if (_fragmentOutput == nullptr)
+        _fragmentOutput = part(Flag::eFragmentOutputInterface, permutation);
+
+    std::vector<std::shared_ptr<Part>> parts = { vertexInputPart, preRasterizationPart, fragmentShaderPart, _fragmentOutput };
+    std::vector<vk::Pipeline> libraries;
+    for (auto& part: parts)
+        libraries.push_back(part->pipeline);
+
+    vk::Device device = _device->raw();
+    vk::PipelineCache cache = _pipelineCache != nullptr ? _pipelineCache->raw() : nullptr;
+    vk::PipelineLayout layout = _pipelineLayout->raw();
+
+    auto fast = linkParts(device, cache, layout, libraries, {});
+
+    // The parts, with their shaders and specializations, and the layout and cache stay alive
+    // until the optimized link is done
+    auto optimized = _threadPool->submit([parts, libraries, device, cache, layout,
+            pipelineLayout = _pipelineLayout, pipelineCache = _pipelineCache]() {
+            return linkParts(device, cache, layout, libraries, vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT);
+            });
+
+    pipeline = std::make_shared<LinkedPipeline_t>(_device, fast, std::move(optimized));
+#endif
+
+    return pipeline;
+}
+
+bool PipelineLibrary_t::supported() {
+    return _supported;
+}
+
+size_t PipelineLibrary_t::parts() {
+    return _vertexInput.size() + _preRasterization.size() + _fragmentShader.size() + (_fragmentOutput != nullptr);
+}
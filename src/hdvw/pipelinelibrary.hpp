@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/pipelinelayout.hpp>
+#include <hdvw/pipelinecache.hpp>
+#include <hdvw/renderpass.hpp>
+#include <hdvw/pipeline.hpp>
+#include <hdvw/threadpool.hpp>
+
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace hd {
+    struct PipelineLibraryCreateInfo {
+        Device device;
+        PipelineLayout pipelineLayout;
+        RenderPass renderPass;
+        PipelineCache pipelineCache = nullptr;
+        // Runs the optimized links, a pool with one worker is made when there is none
+        ThreadPool threadPool = nullptr;
+    };
+
+    // What may change between pipelines of one library, the rest is DefaultPipeline_t's state
+    struct PipelinePermutation {
+        Shader vertex;
+        Shader fragment;
+        Specialization vertexSpecialization = nullptr;
+        Specialization fragmentSpecialization = nullptr;
+        vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+        vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+        vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+        vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+        bool checkDepth = true;
+    };
+
+    class LinkedPipeline_t;
+    typedef std::shared_ptr<LinkedPipeline_t> LinkedPipeline;
+
+    // Starts out as a fast link of the library parts and switches to the link time
+    // optimized pipeline the first time raw() finds it finished
+    class LinkedPipeline_t : public Pipeline_t {
+        private:
+            vk::Device _device;
+            DeletionQueue _deletionQueue;
+            vk::Pipeline _pipeline;
+            std::future<vk::Pipeline> _optimized;
+
+        public:
+            LinkedPipeline_t(Device device, vk::Pipeline pipeline, std::future<vk::Pipeline> optimized);
+
+            vk::Pipeline raw();
+
+            bool optimized();
+
+            ~LinkedPipeline_t();
+    };
+
+    class PipelineLibrary_t;
+    typedef std::shared_ptr<PipelineLibrary_t> PipelineLibrary;
+
+    // Builds pipelines from separately compiled vertex input, pre-rasterization, fragment
+    // shader and fragment output parts with VK_EXT_graphics_pipeline_library, so a new
+    // permutation only compiles the parts it doesn't share. Devices without the extension
+    // get monolithic DefaultPipeline_t objects instead. Viewport and scissor are dynamic.
+    // Not thread safe, the optimized links are the only work done elsewhere.
+    class PipelineLibrary_t {
+        private:
+            // A library pipeline, destroyed once every link using it has been created. Its
+            // key holds a module handle, so the shaders stay alive as long as the part.
+            struct Part {
+                vk::Device device;
+                DeletionQueue deletionQueue;
+                vk::Pipeline pipeline;
+                std::vector<Shader> shaders;
+                std::vector<Specialization> specializations;
+
+                ~Part();
+            };
+
+            struct Linked {
+                Pipeline pipeline;
+                Shader vertex;
+                Shader fragment;
+                Specialization vertexSpecialization;
+                Specialization fragmentSpecialization;
+            };
+
+            // Module handle, entry point and specialization hash come first
+            typedef std::tuple<uint64_t, std::string, uint64_t, uint32_t, vk::FrontFace, vk::PolygonMode> PreRasterizationKey;
+            typedef std::tuple<uint64_t, std::string, uint64_t, bool> FragmentShaderKey;
+            typedef std::tuple<PreRasterizationKey, FragmentShaderKey, vk::PrimitiveTopology> PermutationKey;
+
+            Device _device;
+            PipelineLayout _pipelineLayout;
+            RenderPass _renderPass;
+            PipelineCache _pipelineCache;
+            ThreadPool _threadPool;
+            bool _supported = false;
+
+            std::map<vk::PrimitiveTopology, std::shared_ptr<Part>> _vertexInput;
+            std::map<PreRasterizationKey, std::shared_ptr<Part>> _preRasterization;
+            std::map<FragmentShaderKey, std::shared_ptr<Part>> _fragmentShader;
+            std::shared_ptr<Part> _fragmentOutput;
+            std::map<PermutationKey, Linked> _pipelines;
+
+            DefaultPipelineCreateInfo defaults(const PipelinePermutation& permutation,
+                    std::vector<vk::PipelineShaderStageCreateInfo> shaderInfo, std::vector<Shader> shaders,
+                    std::vector<Specialization> specializations);
+
+#ifdef VK_EXT_graphics_pipeline_library
+            std::shared_ptr<Part> part(vk::GraphicsPipelineLibraryFlagsEXT flags, const PipelinePermutation& permutation);
+#endif
+
+        public:
+            static PipelineLibrary conjure(PipelineLibraryCreateInfo ci) {
+                return std::make_shared<PipelineLibrary_t>(ci);
+            }
+
+            PipelineLibrary_t(PipelineLibraryCreateInfo ci);
+
+            // Cached per permutation, shaders are told apart by module, entry point and specialization.
+            // The shaders and specializations are held for as long as their cache entries.
+            Pipeline link(PipelinePermutation permutation);
+
+            bool supported();
+
+            // Library parts only, linked pipelines are kept by whoever holds them
+            size_t parts();
+    };
+}
@@ -0,0 +1,496 @@
+#include <hdvw/reflection.hpp>
+using namespace hd;
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+namespace {
+    const uint32_t MAGIC = 0x07230203;
+
+    enum Op : uint32_t {
+        OpName = 5,
+        OpEntryPoint = 15,
+        OpExecutionMode = 16,
+        OpTypeBool = 20,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpConstantComposite = 44,
+        OpSpecConstant = 50,
+        OpSpecConstantComposite = 51,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+        OpExecutionModeId = 331,
+        OpTypeAccelerationStructure = 5341,
+    };
+
+    enum Decoration : uint32_t {
+        SpecId = 1,
+        Block = 2,
+        BufferBlock = 3,
+        ArrayStride = 6,
+        MatrixStride = 7,
+        BuiltIn = 11,
+        Location = 30,
+        Binding = 33,
+        DescriptorSet = 34,
+        Offset = 35,
+    };
+
+    enum StorageClass : uint32_t {
+        UniformConstant = 0,
+        Input = 1,
+        Uniform = 2,
+        PushConstant = 9,
+        StorageBuffer = 12,
+    };
+
+    const uint32_t ExecutionModeLocalSize = 17;
+    const uint32_t ExecutionModeLocalSizeId = 38;
+    const uint32_t BuiltInWorkgroupSize = 25;
+    const uint32_t DimBuffer = 5;
+    const uint32_t DimSubpassData = 6;
+
+    struct Id {
+        uint32_t opcode = 0;
+        // Operands after the result id
+        std::vector<uint32_t> operands;
+        std::string name;
+        std::map<uint32_t, uint32_t> decorations;
+        std::map<uint32_t, std::map<uint32_t, uint32_t>> memberDecorations;
+    };
+
+    std::string literal(std::span<const uint32_t> words) {
+        std::string result;
+        for (auto word: words) {
+            for (int byte = 0; byte < 4; byte++) {
+                char c = (word >> (byte * 8)) & 0xFF;
+                if (c == 0)
+                    return result;
+                result += c;
+            }
+        }
+        return result;
+    }
+
+    vk::ShaderStageFlags stageOf(uint32_t executionModel) {
+        switch (executionModel) {
+            case 0: return vk::ShaderStageFlagBits::eVertex;
+            case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+            case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+            case 3: return vk::ShaderStageFlagBits::eGeometry;
+            case 4: return vk::ShaderStageFlagBits::eFragment;
+            case 5: return vk::ShaderStageFlagBits::eCompute;
+            default: throw std::runtime_error("unsupported SPIR-V execution model");
+        }
+    }
+
+    class Parser {
+        private:
+            std::vector<Id> _ids;
+            std::optional<std::array<uint32_t, 3>> _localSizeConstants;
+
+            // A WorkgroupSize builtin wins over the execution modes, both may name spec constants
+            void resolveLocalSize() {
+                for (uint32_t id = 0; id < _ids.size(); id++) {
+                    auto builtIn = decoration(id, BuiltIn);
+                    auto& value = _ids[id];
+                    if (builtIn && *builtIn == BuiltInWorkgroupSize
+                            && (value.opcode == OpConstantComposite || value.opcode == OpSpecConstantComposite))
+                        _localSizeConstants = std::array<uint32_t, 3>{ value.operands[1], value.operands[2], value.operands[3] };
+                }
+
+                if (!_localSizeConstants)
+                    return;
+
+                for (uint32_t dim = 0; dim < 3; dim++) {
+                    uint32_t id = (*_localSizeConstants)[dim];
+                    auto& value = at(id);
+                    if (value.opcode != OpConstant && value.opcode != OpSpecConstant)
+                        throw std::runtime_error("SPIR-V local size is not a scalar constant");
+
+                    localSize[dim] = value.operands[1];
+                    if (value.opcode == OpSpecConstant)
+                        localSizeIds[dim] = decoration(id, SpecId);
+                }
+            }
+
+        public:
+            uint32_t executionModel = 0;
+            uint32_t entryPoint = 0;
+            std::vector<uint32_t> interface;
+            std::array<uint32_t, 3> localSize = { 1, 1, 1 };
+            std::array<std::optional<uint32_t>, 3> localSizeIds = {};
+
+            Parser(std::span<const uint32_t> code) {
+                if (code.size() < 5 || code[0] != MAGIC)
+                    throw std::runtime_error("not a SPIR-V module");
+
+                _ids.resize(code[3]);
+                bool haveEntry = false;
+
+                for (size_t word = 5; word < code.size();) {
+                    uint32_t count = code[word] >> 16;
+                    uint32_t opcode = code[word] & 0xFFFF;
+                    if (count == 0 || word + count > code.size())
+                        throw std::runtime_error("malformed SPIR-V instruction");
+
+                    auto args = code.subspan(word + 1, count - 1);
+                    word += count;
+
+                    switch (opcode) {
+                        case OpName:
+                            at(args[0]).name = literal(args.subspan(1));
+                            break;
+                        case OpEntryPoint: {
+                            if (haveEntry)
+                                break;
+                            haveEntry = true;
+                            executionModel = args[0];
+                            entryPoint = args[1];
+
+                            // The name literal is padded to whole words, interface ids follow it
+                            size_t skip = literal(args.subspan(2)).size() / 4 + 1;
+                            for (size_t iter = 2 + skip; iter < args.size(); iter++)
+                                interface.push_back(args[iter]);
+                            break;
+                        }
+                        case OpExecutionMode:
+                            if (args[0] == entryPoint && args[1] == ExecutionModeLocalSize)
+                                localSize = { args[2], args[3], args[4] };
+                            break;
+                        case OpExecutionModeId:
+                            if (args[0] == entryPoint && args[1] == ExecutionModeLocalSizeId)
+                                _localSizeConstants = std::array<uint32_t, 3>{ args[2], args[3], args[4] };
+                            break;
+                        case OpDecorate:
+                            at(args[0]).decorations[args[1]] = args.size() > 2 ? args[2] : 0;
+                            break;
+                        case OpMemberDecorate:
+                            at(args[0]).memberDecorations[args[1]][args[2]] = args.size() > 3 ? args[3] : 0;
+                            break;
+                        case OpTypeBool:
+                        case OpTypeInt:
+                        case OpTypeFloat:
+                        case OpTypeVector:
+                        case OpTypeMatrix:
+                        case OpTypeImage:
+                        case OpTypeSampler:
+                        case OpTypeSampledImage:
+                        case OpTypeArray:
+                        case OpTypeRuntimeArray:
+                        case OpTypeStruct:
+                        case OpTypePointer:
+                        case OpTypeAccelerationStructure: {
+                            auto& id = at(args[0]);
+                            id.opcode = opcode;
+                            id.operands.assign(args.begin() + 1, args.end());
+                            break;
+                        }
+                        case OpConstant:
+                        case OpConstantComposite:
+                        case OpSpecConstant:
+                        case OpSpecConstantComposite:
+                        case OpVariable: {
+                            // Result type comes first, keep it as the first operand
+                            auto& id = at(args[1]);
+                            id.opcode = opcode;
+                            id.operands.assign({ args[0] });
+                            id.operands.insert(id.operands.end(), args.begin() + 2, args.end());
+                            break;
+                        }
+                    }
+                }
+
+                if (!haveEntry)
+                    throw std::runtime_error("SPIR-V module has no entry point");
+
+                resolveLocalSize();
+            }
+
+            Id& at(uint32_t id) {
+                if (id >= _ids.size())
+                    throw std::runtime_error("SPIR-V id out of bounds");
+                return _ids[id];
+            }
+
+            std::optional<uint32_t> decoration(uint32_t id, uint32_t decoration) {
+                auto& decorations = at(id).decorations;
+                auto found = decorations.find(decoration);
+                if (found == decorations.end())
+                    return std::nullopt;
+                return found->second;
+            }
+
+            uint32_t constant(uint32_t id) {
+                auto& value = at(id);
+                if (value.opcode != OpConstant)
+                    throw std::runtime_error("SPIR-V array length is not a plain constant");
+                return value.operands[1];
+            }
+
+            // Size as laid out in a block, explicit strides win over natural sizes
+            uint32_t size(uint32_t typeId, std::optional<uint32_t> matrixStride = std::nullopt) {
+                auto& type = at(typeId);
+                switch (type.opcode) {
+                    case OpTypeBool:
+                        return 4;
+                    case OpTypeInt:
+                    case OpTypeFloat:
+                        return type.operands[0] / 8;
+                    case OpTypeVector:
+                        return size(type.operands[0]) * type.operands[1];
+                    case OpTypeMatrix:
+                        return (matrixStride ? *matrixStride : size(type.operands[0])) * type.operands[1];
+                    case OpTypeArray: {
+                        auto stride = decoration(typeId, ArrayStride);
+                        return (stride ? *stride : size(type.operands[0])) * constant(type.operands[1]);
+                    }
+                    case OpTypeRuntimeArray:
+                        return 0;
+                    case OpTypeStruct: {
+                        uint32_t end = 0;
+                        for (uint32_t member = 0; member < type.operands.size(); member++) {
+                            auto& decorations = type.memberDecorations[member];
+                            uint32_t offset = decorations.count(Offset) ? decorations[Offset] : 0;
+
+                            std::optional<uint32_t> stride;
+                            if (decorations.count(MatrixStride))
+                                stride = decorations[MatrixStride];
+
+                            end = std::max(end, offset + size(type.operands[member], stride));
+                        }
+                        return end;
+                    }
+                    default:
+                        throw std::runtime_error("SPIR-V type has no size");
+                }
+            }
+
+            vk::DescriptorType descriptorType(uint32_t typeId, uint32_t storage) {
+                auto& type = at(typeId);
+
+                if (storage == StorageBuffer)
+                    return vk::DescriptorType::eStorageBuffer;
+                if (storage == Uniform)
+                    return decoration(typeId, BufferBlock) ? vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eUniformBuffer;
+
+                switch (type.opcode) {
+                    case OpTypeSampler:
+                        return vk::DescriptorType::eSampler;
+                    case OpTypeSampledImage:
+                        if (at(type.operands[0]).operands[1] == DimBuffer)
+                            return vk::DescriptorType::eUniformTexelBuffer;
+                        return vk::DescriptorType::eCombinedImageSampler;
+                    case OpTypeImage: {
+                        uint32_t dim = type.operands[1];
+                        uint32_t sampled = type.operands[5];
+                        if (dim == DimSubpassData)
+                            return vk::DescriptorType::eInputAttachment;
+                        if (dim == DimBuffer)
+                            return sampled == 2 ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+                        return sampled == 2 ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+                    }
+                    case OpTypeAccelerationStructure:
+                        return vk::DescriptorType::eAccelerationStructureKHR;
+                    default:
+                        throw std::runtime_error("unsupported SPIR-V descriptor type");
+                }
+            }
+
+            vk::Format format(uint32_t typeId) {
+                auto& type = at(typeId);
+
+                uint32_t components = 1;
+                uint32_t scalarId = typeId;
+                if (type.opcode == OpTypeVector) {
+                    scalarId = type.operands[0];
+                    components = type.operands[1];
+                }
+
+                auto& scalar = at(scalarId);
+                if (scalar.opcode != OpTypeFloat && scalar.opcode != OpTypeInt)
+                    throw std::runtime_error("unsupported vertex input type");
+                if (scalar.operands[0] != 32)
+                    throw std::runtime_error("only 32 bit vertex inputs are reflected");
+
+                static const vk::Format floats[] = { vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+                    vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat };
+                static const vk::Format sints[] = { vk::Format::eR32Sint, vk::Format::eR32G32Sint,
+                    vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint };
+                static const vk::Format uints[] = { vk::Format::eR32Uint, vk::Format::eR32G32Uint,
+                    vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint };
+
+                if (scalar.opcode == OpTypeFloat)
+                    return floats[components - 1];
+                return scalar.operands[1] ? sints[components - 1] : uints[components - 1];
+            }
+    };
+}
+
+ShaderReflection hd::reflect(std::span<const uint32_t> code) {
+    Parser parser(code);
+
+    ShaderReflection reflection;
+    reflection.stages = stageOf(parser.executionModel);
+    reflection.localSize = parser.localSize;
+    reflection.localSizeIds = parser.localSizeIds;
+
+    for (uint32_t id = 0; id < code[3]; id++) {
+        auto& variable = parser.at(id);
+        if (variable.opcode != OpVariable)
+            continue;
+
+        auto& pointer = parser.at(variable.operands[0]);
+        uint32_t storage = variable.operands[1];
+        uint32_t typeId = pointer.operands[1];
+
+        if (storage == PushConstant) {
+            vk::PushConstantRange range = {};
+            range.stageFlags = reflection.stages;
+
+            // Starts at the first member, blocks often leave room for other stages before it
+            auto& type = parser.at(typeId);
+            uint32_t begin = UINT32_MAX;
+            for (auto& [member, decorations]: type.memberDecorations)
+                if (decorations.count(Offset))
+                    begin = std::min(begin, decorations.at(Offset));
+            range.offset = begin == UINT32_MAX ? 0 : begin;
+            range.size = parser.size(typeId) - range.offset;
+
+            reflection.pushConstants.push_back(range);
+            continue;
+        }
+
+        if (storage == Input && reflection.stages & vk::ShaderStageFlagBits::eVertex) {
+            auto location = parser.decoration(id, Location);
+            if (!location || parser.decoration(id, BuiltIn))
+                continue;
+
+            reflection.inputs.push_back({ *location, parser.format(typeId), variable.name });
+            continue;
+        }
+
+        if (storage != UniformConstant && storage != Uniform && storage != StorageBuffer)
+            continue;
+
+        auto binding = parser.decoration(id, Binding);
+        if (!binding)
+            continue;
+
+        uint32_t count = 1;
+        auto& type = parser.at(typeId);
+        if (type.opcode == OpTypeArray) {
+            count = parser.constant(type.operands[1]);
+            typeId = type.operands[0];
+        } else if (type.opcode == OpTypeRuntimeArray) {
+            count = 0;
+            typeId = type.operands[0];
+        }
+
+        auto set = parser.decoration(id, DescriptorSet);
+        auto name = variable.name.empty() ? parser.at(typeId).name : variable.name;
+
+        reflection.bindings.push_back({
+                .set = set ? *set : 0,
+                .binding = *binding,
+                .type = parser.descriptorType(typeId, storage),
+                .count = count,
+                .stages = reflection.stages,
+                .name = name,
+                });
+    }
+
+    std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](auto& a, auto& b) {
+            return a.location < b.location;
+            });
+
+    return reflection;
+}
+
+ShaderReflection hd::merge(const std::vector<ShaderReflection>& reflections) {
+    ShaderReflection merged;
+    merged.stages = vk::ShaderStageFlags{0};
+
+    for (auto& reflection: reflections) {
+        merged.stages |= reflection.stages;
+
+        for (auto& binding: reflection.bindings) {
+            auto found = std::find_if(merged.bindings.begin(), merged.bindings.end(), [&](auto& other) {
+                    return other.set == binding.set && other.binding == binding.binding;
+                    });
+
+            if (found == merged.bindings.end()) {
+                merged.bindings.push_back(binding);
+                continue;
+            }
+
+            if (found->type != binding.type)
+                throw std::runtime_error("set " + std::to_string(binding.set) + " binding "
+                        + std::to_string(binding.binding) + " has different types across stages");
+
+            found->stages |= binding.stages;
+            found->count = std::max(found->count, binding.count);
+        }
+
+        // Identical ranges share one entry, a stage may only appear in one range
+        for (auto& range: reflection.pushConstants) {
+            auto found = std::find_if(merged.pushConstants.begin(), merged.pushConstants.end(), [&](auto& other) {
+                    return other.offset == range.offset && other.size == range.size;
+                    });
+
+            if (found != merged.pushConstants.end())
+                found->stageFlags |= range.stageFlags;
+            else merged.pushConstants.push_back(range);
+        }
+
+        if (reflection.stages & vk::ShaderStageFlagBits::eVertex)
+            merged.inputs = reflection.inputs;
+        if (reflection.stages & vk::ShaderStageFlagBits::eCompute) {
+            merged.localSize = reflection.localSize;
+            merged.localSizeIds = reflection.localSizeIds;
+        }
+    }
+
+    std::sort(merged.bindings.begin(), merged.bindings.end(), [](auto& a, auto& b) {
+            return std::tie(a.set, a.binding) < std::tie(b.set, b.binding);
+            });
+
+    return merged;
+}
+
+std::array<uint32_t, 3> hd::specializedLocalSize(const ShaderReflection& reflection, const vk::SpecializationInfo* specialization) {
+    auto size = reflection.localSize;
+    if (specialization == nullptr)
+        return size;
+
+    for (uint32_t dim = 0; dim < 3; dim++) {
+        if (!reflection.localSizeIds[dim])
+            continue;
+
+        for (uint32_t iter = 0; iter < specialization->mapEntryCount; iter++) {
+            auto& entry = specialization->pMapEntries[iter];
+            if (entry.constantID != *reflection.localSizeIds[dim])
+                continue;
+
+            if (entry.size != sizeof(uint32_t))
+                throw std::invalid_argument("Local size specialization constants are 32 bit");
+            std::memcpy(&size[dim], static_cast<const std::byte*>(specialization->pData) + entry.offset, sizeof(uint32_t));
+        }
+    }
+
+    return size;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace hd {
+    struct ReflectedBinding {
+        uint32_t set;
+        uint32_t binding;
+        vk::DescriptorType type;
+        // Zero for runtime sized arrays
+        uint32_t count;
+        vk::ShaderStageFlags stages;
+        std::string name;
+    };
+
+    struct ReflectedInput {
+        uint32_t location;
+        vk::Format format;
+        std::string name;
+    };
+
+    struct ShaderReflection {
+        vk::ShaderStageFlags stages;
+        std::vector<ReflectedBinding> bindings;
+        std::vector<vk::PushConstantRange> pushConstants;
+        // Vertex stage only, sorted by location
+        std::vector<ReflectedInput> inputs;
+        // Defaults of any dimension set with local_size_x_id and friends
+        std::array<uint32_t, 3> localSize = { 1, 1, 1 };
+        // Specialization constant behind each dimension, if any
+        std::array<std::optional<uint32_t>, 3> localSizeIds = {};
+    };
+
+    // Reads the interface of the first entry point straight from the SPIR-V words
+    ShaderReflection reflect(std::span<const uint32_t> code);
+
+    // Bindings shared between stages are combined, a clash in type throws
+    ShaderReflection merge(const std::vector<ShaderReflection>& reflections);
+
+    // The local size a pipeline built with this specialization runs with
+    std::array<uint32_t, 3> specializedLocalSize(const ShaderReflection& reflection, const vk::SpecializationInfo* specialization);
+}
@@ -3,6 +3,7 @@ using namespace hd;
 
 SwapChainRenderPass_t::SwapChainRenderPass_t(SwapChainRenderPassCreateInfo ci) {
     _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
 
     vk::AttachmentDescription colorAttachment = {};
     colorAttachment.format = ci.swapChain->format();
@@ -41,10 +42,12 @@ SwapChainRenderPass_t::SwapChainRenderPass_t(SwapChainRenderPassCreateInfo ci) {
     vk::SubpassDependency dependency = {};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    dependency.srcAccessMask = vk::AccessFlags{0};
-    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
+    // The depth image is shared by all frames, so the previous frame's depth writes have to finish first
+    dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests;
+    dependency.srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite
+        | vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
 
     std::vector<vk::AttachmentDescription> attachments = { colorAttachment, depthAttachment };
 
@@ -64,5 +67,5 @@ vk::RenderPass SwapChainRenderPass_t::raw() {
 }
 
 SwapChainRenderPass_t::~SwapChainRenderPass_t() {
-    _device.destroy(_renderPass);
+    _deletionQueue->destroy(_device, _renderPass);
 }
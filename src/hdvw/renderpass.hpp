@@ -27,6 +27,7 @@ namespace hd {
         private:
             vk::RenderPass _renderPass;
             vk::Device _device;
+            DeletionQueue _deletionQueue;
 
         public:
             static RenderPass conjure(SwapChainRenderPassCreateInfo ci) {
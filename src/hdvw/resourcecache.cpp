@@ -0,0 +1,166 @@
+#include <hdvw/resourcecache.hpp>
+using namespace hd;
+
+#include <hdvw/mappedfile.hpp>
+#include <hdvw/hash.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <future>
+
+ResourceCache_t::ResourceCache_t(ResourceCacheCreateInfo ci) {
+    _device = ci.device;
+    _allocator = ci.allocator;
+    _uploadContext = ci.uploadContext;
+    _mipmaps = ci.mipmaps;
+
+    _threadPool = ci.threadPool;
+    if (_threadPool == nullptr)
+        _threadPool = ThreadPool_t::conjure({});
+}
+
+Texture ResourceCache_t::texture(const std::string& filename) {
+    return textures({ filename }).front();
+}
+
+std::vector<Texture> ResourceCache_t::textures(const std::vector<std::string>& filenames) {
+    std::vector<TextureKey> keys;
+    std::vector<FileHash> stats;
+    std::vector<std::future<uint64_t>> hashes;
+    keys.reserve(filenames.size());
+    stats.reserve(filenames.size());
+    hashes.reserve(filenames.size());
+
+    // Only files that changed since they were last hashed get mapped
+    for (auto& filename: filenames) {
+        auto path = std::filesystem::weakly_canonical(filename).string();
+        FileHash stat = { std::filesystem::last_write_time(path), std::filesystem::file_size(path), 0 };
+
+        auto cached = _hashes.find(path);
+        if (cached != _hashes.end() && cached->second.time == stat.time && cached->second.size == stat.size) {
+            stat.hash = cached->second.hash;
+            hashes.emplace_back();
+        } else {
+            hashes.push_back(_threadPool->submit([filename]() {
+                        auto file = MappedFile_t::conjure({ .filename = filename.c_str() });
+                        return fnv1a(file->data());
+                        }));
+        }
+
+        keys.push_back({ path, 0 });
+        stats.push_back(stat);
+    }
+
+    for (size_t iter = 0; iter < keys.size(); iter++) {
+        if (hashes[iter].valid()) {
+            stats[iter].hash = hashes[iter].get();
+            _hashes[std::get<0>(keys[iter])] = stats[iter];
+        }
+        std::get<1>(keys[iter]) = stats[iter].hash;
+    }
+
+    // A file listed twice is only loaded once
+    std::vector<std::string> missing;
+    std::vector<TextureKey> missingKeys;
+    for (size_t iter = 0; iter < keys.size(); iter++) {
+        if (_textures.count(keys[iter]) || std::find(missingKeys.begin(), missingKeys.end(), keys[iter]) != missingKeys.end())
+            continue;
+
+        missing.push_back(filenames[iter]);
+        missingKeys.push_back(keys[iter]);
+    }
+
+    if (!missing.empty()) {
+        auto loader = TextureLoader_t::conjure({
+                .device = _device,
+                .allocator = _allocator,
+                .uploadContext = _uploadContext,
+                .threadPool = _threadPool,
+                .mipmaps = _mipmaps,
+                .sampler = sampler({ .addressMode = vk::SamplerAddressMode::eRepeat }),
+                });
+
+        auto loaded = loader->load(missing);
+        for (size_t iter = 0; iter < loaded.size(); iter++)
+            _textures[missingKeys[iter]] = loaded[iter];
+    }
+
+    std::vector<Texture> result;
+    result.reserve(keys.size());
+    for (auto& key: keys)
+        result.push_back(_textures.at(key));
+
+    return result;
+}
+
+Sampler ResourceCache_t::sampler(SamplerCreateInfo ci) {
+    ci.device = _device;
+
+    auto& sampler = _samplers[ci];
+    if (sampler == nullptr)
+        sampler = Sampler_t::conjure(ci);
+
+    return sampler;
+}
+
+ImageView ResourceCache_t::view(Image image, vk::ImageViewType type) {
+    return view(image, image->format(), image->range(), type);
+}
+
+// Keyed by the current handle, an image moved by defragmentation gets a new view
+ImageView ResourceCache_t::view(Image image, vk::Format format, vk::ImageSubresourceRange range, vk::ImageViewType type) {
+    ViewKey key = {
+        (uint64_t) static_cast<VkImage>(image->raw()), image->generation(), format, type,
+        static_cast<uint32_t>(range.aspectMask), range.baseMipLevel, range.levelCount,
+        range.baseArrayLayer, range.layerCount,
+    };
+
+    auto& entry = _views[key];
+    if (entry.view == nullptr) {
+        entry.image = image;
+        entry.view = ImageView_t::conjure({
+                .image = image->raw(),
+                .device = _device,
+                .format = format,
+                .range = range,
+                .type = type,
+                });
+    }
+
+    return entry.view;
+}
+
+size_t ResourceCache_t::purge() {
+    size_t purged = 0;
+
+    std::erase_if(_views, [&](auto& item) {
+            bool unused = item.second.view.use_count() == 1;
+            purged += unused;
+            return unused;
+            });
+
+    std::erase_if(_textures, [&](auto& item) {
+            bool unused = item.second.use_count() == 1;
+            purged += unused;
+            return unused;
+            });
+
+    std::erase_if(_samplers, [&](auto& item) {
+            bool unused = item.second.use_count() == 1;
+            purged += unused;
+            return unused;
+            });
+
+    // Hashes are bookkeeping, they go with the last texture of their file
+    std::erase_if(_hashes, [&](auto& item) {
+            return std::none_of(_textures.begin(), _textures.end(), [&](auto& texture) {
+                    return std::get<0>(texture.first) == item.first;
+                    });
+            });
+
+    return purged;
+}
+
+size_t ResourceCache_t::size() {
+    return _textures.size() + _samplers.size() + _views.size();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/allocator.hpp>
+#include <hdvw/image.hpp>
+#include <hdvw/upload.hpp>
+#include <hdvw/texture.hpp>
+#include <hdvw/textureloader.hpp>
+#include <hdvw/threadpool.hpp>
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace hd {
+    struct ResourceCacheCreateInfo {
+        Device device;
+        Allocator allocator;
+        UploadContext uploadContext;
+        ThreadPool threadPool = nullptr;
+        bool mipmaps = true;
+    };
+
+    class ResourceCache_t;
+    typedef std::shared_ptr<ResourceCache_t> ResourceCache;
+
+    // Hands out shared textures, samplers and image views instead of creating duplicates.
+    // Entries stay alive while cached, purge() drops the ones nobody else holds.
+    // Not thread safe, use it from the thread that records uploads.
+    class ResourceCache_t {
+        private:
+            typedef std::tuple<std::string, uint64_t> TextureKey;
+            typedef std::tuple<uint64_t, uint64_t, vk::Format, vk::ImageViewType,
+                    uint32_t, uint32_t, uint32_t, uint32_t, uint32_t> ViewKey;
+
+            // Content hash of a file as of its last write time and size
+            struct FileHash {
+                std::filesystem::file_time_type time;
+                std::uintmax_t size;
+                uint64_t hash;
+            };
+
+            struct ViewEntry {
+                Image image;
+                ImageView view;
+            };
+
+            Device _device;
+            Allocator _allocator;
+            UploadContext _uploadContext;
+            ThreadPool _threadPool;
+            bool _mipmaps;
+
+            std::map<TextureKey, Texture> _textures;
+            std::map<SamplerCreateInfo, Sampler> _samplers;
+            std::map<ViewKey, ViewEntry> _views;
+            std::map<std::string, FileHash> _hashes;
+
+        public:
+            static ResourceCache conjure(ResourceCacheCreateInfo ci) {
+                return std::make_shared<ResourceCache_t>(ci);
+            }
+
+            ResourceCache_t(ResourceCacheCreateInfo ci);
+
+            // Keyed by canonical path and content hash, an edited file loads again.
+            // Files are only hashed again once their write time or size changes.
+            Texture texture(const std::string& filename);
+
+            // Misses are loaded together through one TextureLoader_t
+            std::vector<Texture> textures(const std::vector<std::string>& filenames);
+
+            // The device of ci is ignored, samplers are made on the cache's device
+            Sampler sampler(SamplerCreateInfo ci);
+
+            // Covers every level and layer of the image in its own format
+            ImageView view(Image image, vk::ImageViewType type = vk::ImageViewType::e2D);
+
+            ImageView view(Image image, vk::Format format, vk::ImageSubresourceRange range, vk::ImageViewType type);
+
+            size_t purge();
+
+            size_t size();
+    };
+}
@@ -2,6 +2,8 @@
 using namespace hd;
 
 #include <fstream>
+#include <stdexcept>
+#include <string>
 
 std::vector<char> Shader_t::read(const char* filename) {
     std::ifstream _file(filename, std::ios::ate | std::ios::binary);
@@ -30,6 +32,10 @@ Shader_t::Shader_t(ShaderCreateInfo ci) {
     createInfo.codeSize = code.size();
     createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
+    _reflection = reflect({ createInfo.pCode, code.size() / sizeof(uint32_t) });
+    if (_reflection.stages != vk::ShaderStageFlags(ci.stage))
+        throw std::invalid_argument(std::string(ci.filename) + " is not a shader for the requested stage");
+
     _shaderModule = _device.createShaderModule(createInfo);
 
     _shaderStageInfo.stage = ci.stage;
@@ -41,6 +47,16 @@ vk::PipelineShaderStageCreateInfo Shader_t::info() {
     return _shaderStageInfo;
 }
 
+vk::PipelineShaderStageCreateInfo Shader_t::info(Specialization specialization) {
+    auto info = _shaderStageInfo;
+    info.pSpecializationInfo = specialization->info();
+    return info;
+}
+
+const ShaderReflection& Shader_t::reflection() {
+    return _reflection;
+}
+
 Shader_t::~Shader_t() {
     _device.destroy(_shaderModule);
 }
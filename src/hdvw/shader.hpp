@@ -3,6 +3,8 @@
 #include <vulkan/vulkan.hpp>
 
 #include <hdvw/device.hpp>
+#include <hdvw/reflection.hpp>
+#include <hdvw/specialization.hpp>
 
 #include <vector>
 #include <memory>
@@ -22,6 +24,7 @@ namespace hd {
             vk::Device _device;
             vk::ShaderModule _shaderModule;
             vk::PipelineShaderStageCreateInfo _shaderStageInfo = {};
+            ShaderReflection _reflection;
 
             std::vector<char> read(const char* filename);
 
@@ -34,6 +37,12 @@ namespace hd {
 
             vk::PipelineShaderStageCreateInfo info();
 
+            // A variant of the stage, the specialization has to outlive pipeline creation.
+            // Asynchronous compiles need it in DefaultPipelineCreateInfo::specializations.
+            vk::PipelineShaderStageCreateInfo info(Specialization specialization);
+
+            const ShaderReflection& reflection();
+
             ~Shader_t();
     };
 }
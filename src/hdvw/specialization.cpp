@@ -0,0 +1,62 @@
+#include <hdvw/specialization.hpp>
+using namespace hd;
+
+#include <hdvw/hash.hpp>
+
+#include <cstring>
+#include <span>
+
+Specialization_t::Specialization_t(std::vector<std::byte> data, std::vector<vk::SpecializationMapEntry> entries) {
+    _data = std::move(data);
+    _entries = std::move(entries);
+
+    _info.mapEntryCount = _entries.size();
+    _info.pMapEntries = _entries.data();
+    _info.dataSize = _data.size();
+    _info.pData = _data.data();
+
+    _hash = hd::hash(&_info, FNV_OFFSET);
+}
+
+const vk::SpecializationInfo* Specialization_t::info() {
+    return &_info;
+}
+
+uint64_t Specialization_t::hash() {
+    return _hash;
+}
+
+// Only the bytes the entries select count, padding in the constant struct doesn't
+uint64_t hd::hash(const vk::SpecializationInfo* info, uint64_t seed) {
+    if (info == nullptr)
+        return fnv1a(uint32_t(0), seed);
+
+    uint64_t hash = fnv1a(info->mapEntryCount, seed);
+    auto data = static_cast<const std::byte*>(info->pData);
+    for (uint32_t iter = 0; iter < info->mapEntryCount; iter++) {
+        auto& entry = info->pMapEntries[iter];
+        hash = fnv1a(entry.constantID, hash);
+        hash = fnv1a(std::span(data + entry.offset, entry.size), hash);
+    }
+
+    return hash;
+}
+
+bool hd::equal(const vk::SpecializationInfo* a, const vk::SpecializationInfo* b) {
+    if (a == nullptr || b == nullptr)
+        return a == b;
+    if (a->mapEntryCount != b->mapEntryCount)
+        return false;
+
+    auto dataA = static_cast<const std::byte*>(a->pData);
+    auto dataB = static_cast<const std::byte*>(b->pData);
+    for (uint32_t iter = 0; iter < a->mapEntryCount; iter++) {
+        auto& entryA = a->pMapEntries[iter];
+        auto& entryB = b->pMapEntries[iter];
+        if (entryA.constantID != entryB.constantID || entryA.size != entryB.size
+                || std::memcmp(dataA + entryA.offset, dataB + entryB.offset, entryA.size) != 0)
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace hd {
+    class Specialization_t;
+    typedef std::shared_ptr<Specialization_t> Specialization;
+
+    // Specialization constants taken from the members of a plain struct, constant_id i is
+    // the i-th member pointer passed to conjure. Use VkBool32 for toggles, bool has the wrong size.
+    //
+    //     struct Tile { uint32_t width = 16; uint32_t height = 16; VkBool32 friction = VK_TRUE; };
+    //     auto tile = Specialization_t::conjure(Tile{}, &Tile::width, &Tile::height, &Tile::friction);
+    class Specialization_t {
+        private:
+            std::vector<std::byte> _data;
+            std::vector<vk::SpecializationMapEntry> _entries;
+            vk::SpecializationInfo _info = {};
+            uint64_t _hash;
+
+        public:
+            template<class Constants, class... Members>
+            static Specialization conjure(const Constants& constants, Members Constants::*... members) {
+                static_assert(std::is_trivially_copyable_v<Constants>, "Specialization constants are copied bytewise");
+                static_assert(((std::is_arithmetic_v<Members> && !std::is_same_v<Members, bool>
+                                && (sizeof(Members) == 4 || sizeof(Members) == 8)) && ...),
+                        "Specialization constants are 32 or 64 bit scalars");
+
+                constexpr std::array<size_t, sizeof...(Members)> sizes = { sizeof(Members)... };
+                auto base = reinterpret_cast<const std::byte*>(&constants);
+                std::array<const std::byte*, sizeof...(Members)> addresses = {
+                    reinterpret_cast<const std::byte*>(&(constants.*members))...
+                };
+
+                std::vector<vk::SpecializationMapEntry> entries;
+                for (uint32_t id = 0; id < sizeof...(Members); id++)
+                    entries.push_back({ id, static_cast<uint32_t>(addresses[id] - base), sizes[id] });
+
+                return std::make_shared<Specialization_t>(std::vector<std::byte>(base, base + sizeof(Constants)), entries);
+            }
+
+            Specialization_t(std::vector<std::byte> data, std::vector<vk::SpecializationMapEntry> entries);
+
+            Specialization_t(const Specialization_t&) = delete;
+
+            Specialization_t& operator=(const Specialization_t&) = delete;
+
+            // Points into this object, which has to outlive any pipeline creation using it
+            const vk::SpecializationInfo* info();
+
+            uint64_t hash();
+    };
+
+    // Covers the constant ids, sizes and values, so two variants of a shader never collide
+    uint64_t hash(const vk::SpecializationInfo* info, uint64_t seed);
+
+    // Same constant ids with the same values, compared like hash()
+    bool equal(const vk::SpecializationInfo* a, const vk::SpecializationInfo* b);
+}
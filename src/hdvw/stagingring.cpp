@@ -0,0 +1,114 @@
+#include <hdvw/stagingring.hpp>
+using namespace hd;
+
+#include <stdexcept>
+
+StagingRing_t::StagingRing_t(StagingRingCreateInfo ci) {
+    _device = ci.device;
+    _allocator = ci.allocator;
+
+    _buffer = Buffer_t::conjure({
+            .allocator = _allocator,
+            .size = ci.size,
+            .bufferUsage = vk::BufferUsageFlagBits::eTransferSrc,
+            .memoryUsage = VMA_MEMORY_USAGE_CPU_ONLY,
+            .mapped = true,
+            .category = MemoryCategory::eStaging,
+            });
+
+    _data = static_cast<char*>(_buffer->data());
+}
+
+bool StagingRing_t::reserve(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset) {
+    if (_used == 0)
+        _head = 0;
+
+    vk::DeviceSize start = (_head + alignment - 1) / alignment * alignment;
+    vk::DeviceSize need = start - _head + size;
+
+    if (start + size > _buffer->size()) {
+        start = 0;
+        need = _buffer->size() - _head + size;
+    }
+
+    if (_used + need > _buffer->size())
+        return false;
+
+    offset = start;
+    _head = start + size;
+    _used += need;
+    _pending += need;
+    return true;
+}
+
+StagingRegion StagingRing_t::allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+    if (size > _buffer->size())
+        throw std::invalid_argument("Staging allocation is larger than the ring, split it into chunks");
+
+    reclaim();
+
+    vk::DeviceSize offset;
+    while (!reserve(size, alignment, offset)) {
+        if (_epochs.empty())
+            throw std::runtime_error("Staging ring is full of unsealed uploads");
+
+        _epochs.front().fence->wait();
+        reclaim();
+    }
+
+    return { _buffer, offset, size, _data + offset };
+}
+
+bool StagingRing_t::fits(vk::DeviceSize size, vk::DeviceSize alignment) {
+    reclaim();
+
+    auto head = _head;
+    auto used = _used;
+    auto pending = _pending;
+
+    vk::DeviceSize offset;
+    bool result = reserve(size, alignment, offset);
+
+    _head = head;
+    _used = used;
+    _pending = pending;
+    return result;
+}
+
+Fence StagingRing_t::seal() {
+    _buffer->flush();
+
+    Fence fence;
+    if (!_spare.empty()) {
+        fence = _spare.back();
+        _spare.pop_back();
+    } else fence = Fence_t::conjure({ .device = _device, .state = FenceState::eIdle });
+
+    _epochs.push_back({ fence, _pending });
+    _pending = 0;
+
+    return fence;
+}
+
+void StagingRing_t::reclaim() {
+    while (!_epochs.empty() && _epochs.front().fence->signaled()) {
+        auto& epoch = _epochs.front();
+        _used -= epoch.size;
+
+        // Someone else still holds the fence, let them own it from now on
+        if (epoch.fence.use_count() == 1) {
+            epoch.fence->reset();
+            _spare.push_back(epoch.fence);
+        }
+
+        _epochs.pop_front();
+    }
+}
+
+vk::DeviceSize StagingRing_t::capacity() {
+    return _buffer->size();
+}
+
+Buffer StagingRing_t::buffer() {
+    return _buffer;
+}
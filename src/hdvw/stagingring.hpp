@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/allocator.hpp>
+#include <hdvw/buffer.hpp>
+#include <hdvw/fence.hpp>
+
+#include <deque>
+#include <vector>
+#include <memory>
+
+namespace hd {
+    struct StagingRingCreateInfo {
+        Device device;
+        Allocator allocator;
+        vk::DeviceSize size = 64 * 1024 * 1024;
+    };
+
+    struct StagingRegion {
+        Buffer buffer;
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+        void* data;
+    };
+
+    class StagingRing_t;
+    typedef std::shared_ptr<StagingRing_t> StagingRing;
+
+    // One persistently mapped upload buffer that every transfer sub-allocates from.
+    // Regions handed out since the last seal() are released once the fence returned
+    // by seal() is signaled, so callers must submit the copies reading them with it.
+    class StagingRing_t {
+        private:
+            struct Epoch {
+                Fence fence;
+                vk::DeviceSize size;
+            };
+
+            Buffer _buffer;
+            Allocator _allocator;
+            Device _device;
+            char* _data;
+
+            vk::DeviceSize _head = 0;
+            vk::DeviceSize _used = 0;
+            vk::DeviceSize _pending = 0;
+
+            std::deque<Epoch> _epochs;
+            std::vector<Fence> _spare;
+
+            bool reserve(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+
+        public:
+            static StagingRing conjure(StagingRingCreateInfo ci) {
+                return std::make_shared<StagingRing_t>(ci);
+            }
+
+            StagingRing_t(StagingRingCreateInfo ci);
+
+            StagingRegion allocate(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+            bool fits(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+            Fence seal();
+
+            void reclaim();
+
+            vk::DeviceSize capacity();
+
+            Buffer buffer();
+    };
+}
@@ -3,6 +3,19 @@ using namespace hd;
 
 #include <GLFW/glfw3.h>
 
+#include <stdexcept>
+
+vk::Format hd::findDepthFormat(Device device) {
+    for (vk::Format format : { vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint }) {
+        vk::FormatProperties props = device->physical().getFormatProperties(format);
+
+        if (props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+            return format;
+    }
+
+    throw std::runtime_error("No depth format is supported by the device");
+}
+
 vk::SurfaceFormatKHR SwapChain_t::chooseSwapSurfaceFormat(SwapChainSupportDetails& support) {
     for (const auto& format : support.formats) {
         if ((format.format == vk::Format::eB8G8R8A8Srgb) && (format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear)) {
@@ -46,6 +59,7 @@ vk::Extent2D SwapChain_t::chooseSwapExtent(SwapChainSupportDetails& support, Win
 
 SwapChain_t::SwapChain_t(SwapChainCreateInfo ci) {
     _device = ci.device->raw();
+    _deletionQueue = ci.device->deletionQueue();
     auto indices = ci.device->indices();
     auto support = ci.device->swapChainSupport();
 
@@ -87,22 +101,18 @@ SwapChain_t::SwapChain_t(SwapChainCreateInfo ci) {
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
 
+    // Hands presentation over without waiting, the old swapchain is retired from here on
+    if (ci.oldSwapChain != nullptr)
+        createInfo.oldSwapchain = ci.oldSwapChain->raw();
+
     _swapChain = _device.createSwapchainKHR(createInfo);
     _format = surfaceFormat.format;
     _extent = extent;
 
-    for (vk::Format format : { vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint }) {
-        vk::FormatProperties props = ci.device->physical().getFormatProperties(format);
-
-        if (props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
-            _depthFormat = format;
-            break;
-        }
-    }
+    _depthFormat = findDepthFormat(ci.device);
 
     auto images = _device.getSwapchainImagesKHR(_swapChain);
     _colorImages.reserve(images.size());
-    _depthImages.reserve(images.size());
 
     for (auto& img: images) {
         _colorImages.push_back(Attachment_t::conjure({
@@ -112,16 +122,26 @@ SwapChain_t::SwapChain_t(SwapChainCreateInfo ci) {
                     .usage = vk::ImageUsageFlagBits::eColorAttachment,
                     .aspect = vk::ImageAspectFlagBits::eColor,
                     }));
-
-        _depthImages.push_back(Attachment_t::conjure({
-                    .device = ci.device,
-                    .allocator = ci.allocator,
-                    .format = _depthFormat,
-                    .usage = vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                    .aspect = vk::ImageAspectFlagBits::eDepth,
-                    .extent = _extent,
-                    }));
     }
+
+    // Depth is cleared on load and never stored, so every framebuffer shares one image.
+    // Where the device has lazily allocated memory it may never be backed at all.
+    bool lazy = false;
+    auto memory = ci.device->physical().getMemoryProperties();
+    for (uint32_t i = 0; i < memory.memoryTypeCount; i++)
+        if (memory.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eLazilyAllocated)
+            lazy = true;
+
+    _depthImage = Attachment_t::conjure({
+                .device = ci.device,
+                .allocator = ci.allocator,
+                .format = _depthFormat,
+                .usage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment,
+                .aspect = vk::ImageAspectFlagBits::eDepth,
+                .extent = _extent,
+                .pool = lazy ? "" : ci.depthPool,
+                .memoryUsage = lazy ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY,
+                });
 }
 
 vk::Format SwapChain_t::format() {
@@ -144,8 +164,8 @@ Attachment SwapChain_t::colorAttachment(uint32_t index) {
     return _colorImages.at(index);
 }
 
-Attachment SwapChain_t::depthAttachment(uint32_t index) {
-    return _depthImages.at(index);
+Attachment SwapChain_t::depthAttachment() {
+    return _depthImage;
 }
 
 vk::SwapchainKHR SwapChain_t::raw() {
@@ -153,5 +173,5 @@ vk::SwapchainKHR SwapChain_t::raw() {
 }
 
 SwapChain_t::~SwapChain_t() {
-    _device.destroy(_swapChain);
+    _deletionQueue->destroy(_device, _swapChain);
 }
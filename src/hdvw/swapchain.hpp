@@ -8,8 +8,15 @@
 #include <hdvw/attachment.hpp>
 
 #include <memory>
+#include <string>
 
 namespace hd {
+    // First of D32, D32S8 and D24S8 usable as a depth attachment, pools for depth memory need it too
+    vk::Format findDepthFormat(Device device);
+
+    class SwapChain_t;
+    typedef std::shared_ptr<SwapChain_t> SwapChain;
+
     struct SwapChainCreateInfo {
         Window window;
         Surface surface;
@@ -17,18 +24,18 @@ namespace hd {
         Device device;
         vk::PresentModeKHR presentMode;
         std::optional<uint32_t> imageCount;
+        std::string depthPool = "";
+        SwapChain oldSwapChain = nullptr;
     };
 
-    class SwapChain_t;
-    typedef std::shared_ptr<SwapChain_t> SwapChain;
-
     class SwapChain_t {
         private:
             vk::Device _device;
+            DeletionQueue _deletionQueue;
             vk::SwapchainKHR _swapChain;
 
             std::vector<Attachment> _colorImages;
-            std::vector<Attachment> _depthImages;
+            Attachment _depthImage;
 
             vk::Extent2D _extent;
             vk::Format _format;
@@ -57,7 +64,7 @@ namespace hd {
 
             Attachment colorAttachment(uint32_t index);
 
-            Attachment depthAttachment(uint32_t index);
+            Attachment depthAttachment();
 
             vk::SwapchainKHR raw();
 
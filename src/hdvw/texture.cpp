@@ -1,74 +1,207 @@
 #include <hdvw/texture.hpp>
 using namespace hd;
 
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
 Texture_t::Texture_t(TextureCreateInfo ci) {
+    _device = ci.device;
+
+    if (ci.image != nullptr) {
+        _image = ci.image;
+        _token = ci.token;
+    } else if (std::string_view(ci.filename).ends_with(".ktx2"))
+        loadKtx2(ci);
+    else loadImage(ci);
+
+    _viewType = _image->layers() > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+
+    _imageView = ImageView_t::conjure({
+            .image = _image->raw(),
+            .device = ci.device,
+            .format = _image->format(),
+            .range = _image->range(),
+            .type = _viewType,
+            });
+
+    _sampler = ci.sampler;
+    if (_sampler == nullptr)
+        _sampler = Sampler_t::conjure({
+                .device = ci.device,
+                .addressMode = vk::SamplerAddressMode::eRepeat,
+                .maxLod = (float) _image->mipLevels(),
+                });
+}
+
+void Texture_t::loadImage(TextureCreateInfo& ci) {
     int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(ci.filename, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    std::unique_ptr<stbi_uc, void (*)(void*)> pixels(
+            stbi_load(ci.filename, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha), stbi_image_free);
 
     if (!pixels) {
         throw std::runtime_error("failed to load texture image!");
     }
 
-    Buffer stagingBuffer = Buffer_t::conjure({
+    vk::Extent2D extent = {(uint32_t) texWidth, (uint32_t) texHeight};
+    vk::Format format = vk::Format::eR8G8B8A8Srgb;
+    uint32_t mipLevels = ci.mipmaps ? mipLevelCount(extent) : 1;
+    bool blit = supportsLinearBlit(ci.device, format);
+
+    _image = Image_t::conjure({
             .allocator = ci.allocator,
-            .size = imageSize,
-            .bufferUsage = vk::BufferUsageFlagBits::eTransferSrc,
-            .memoryUsage = VMA_MEMORY_USAGE_CPU_ONLY,
+            .extent = extent,
+            .format = format,
+            .mipLevels = mipLevels,
+            .imageUsage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+            .memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .movable = true,
             });
 
-    void* data;
-    ci.allocator->map(stagingBuffer->memory(), data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    ci.allocator->unmap(stagingBuffer->memory());
+    auto bytes = [](const stbi_uc* data, vk::Extent2D extent) {
+        return std::span<const std::byte>(reinterpret_cast<const std::byte*>(data), extent.width * extent.height * 4);
+    };
+
+    // Without linear blits the chain is filtered here and every level is uploaded
+    std::vector<std::vector<uint8_t>> filtered;
+    std::vector<std::span<const std::byte>> levels = { bytes(pixels.get(), extent) };
+    if (mipLevels > 1 && !blit) {
+        const stbi_uc* previous = pixels.get();
+        for (uint32_t level = 1; level < mipLevels; level++) {
+            filtered.push_back(downsampleSrgba8(previous, _image->extent(level - 1), _image->extent(level)));
+            previous = filtered.back().data();
+            levels.push_back(bytes(previous, _image->extent(level)));
+        }
+    }
+
+    upload(ci, levels, mipLevels > 1 && blit);
+}
 
-    stbi_image_free(pixels);
+// Level data is copied from the mapped file into staging memory as is, nothing is decoded
+void Texture_t::loadKtx2(TextureCreateInfo& ci) {
+    auto file = Ktx2File_t::conjure({ .filename = ci.filename });
+
+    auto features = ci.device->physical().getFormatProperties(file->format()).optimalTilingFeatures;
+    if (!(features & vk::FormatFeatureFlagBits::eSampledImage))
+        throw std::runtime_error("texture format is not supported by the device!");
+
+    bool generate = ci.mipmaps && file->mipLevels() == 1 && supportsLinearBlit(ci.device, file->format());
 
     _image = Image_t::conjure({
             .allocator = ci.allocator,
-            .extent = {(uint32_t) texWidth, (uint32_t) texHeight},
-            .format = vk::Format::eR8G8B8A8Srgb,
-            .imageUsage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+            .extent = file->extent(),
+            .format = file->format(),
+            .layers = file->layers(),
+            .mipLevels = generate ? mipLevelCount(file->extent()) : file->mipLevels(),
+            .imageUsage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
             .memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .movable = true,
             });
 
-    auto buff = ci.commandPool->singleTimeBegin();
-    buff->transitionImageLayout({
-            .image = _image,
-            .layout = vk::ImageLayout::eTransferDstOptimal,
-            });
-    buff->copy({
-            .buffer = stagingBuffer,
-            .image = _image,
-            });
-    buff->transitionImageLayout({
-            .image = _image,
-            .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
-            });
-    ci.commandPool->singleTimeEnd(buff, ci.queue);
+    std::vector<std::span<const std::byte>> levels;
+    for (uint32_t level = 0; level < file->mipLevels(); level++)
+        levels.push_back(file->level(level));
 
-    _imageView = ImageView_t::conjure({
-            .image = _image->raw(),
-            .device = ci.device,
-            .format = _image->format(),
-            .range = _image->range(),
-            .type = vk::ImageViewType::e2D,
-            });
+    upload(ci, levels, generate);
+}
 
-    _sampler = Sampler_t::conjure({
-            .device = ci.device,
-            .addressMode = vk::SamplerAddressMode::eRepeat,
-            });
+void Texture_t::upload(TextureCreateInfo& ci, const std::vector<std::span<const std::byte>>& levels, bool generate) {
+    if (ci.uploadBatch != nullptr || ci.uploadContext != nullptr) {
+        auto batch = ci.uploadBatch;
+        if (batch == nullptr)
+            batch = UploadBatch_t::conjure({ .uploadContext = ci.uploadContext });
+
+        for (uint32_t level = 0; level < levels.size(); level++)
+            batch->upload(_image, levels[level].data(), levels[level].size(), level);
+
+        if (generate)
+            batch->generateMips(_image);
+
+        if (ci.uploadBatch == nullptr)
+            _token = batch->flush();
+        return;
+    }
+
+    auto block = formatBlockExtent(_image->format());
+
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        auto levelExtent = _image->extent(level);
+        uint32_t blockRows = (levelExtent.height + block.height - 1) / block.height;
+        VkDeviceSize layerSize = levels[level].size() / _image->layers();
+        VkDeviceSize rowSize = layerSize / blockRows;
+        uint32_t rowsPerChunk = std::min<VkDeviceSize>(ci.stagingRing->capacity() / rowSize, blockRows);
+
+        if (rowsPerChunk == 0)
+            throw std::runtime_error("texture row does not fit into the staging ring!");
+
+        for (uint32_t layer = 0; layer < _image->layers(); layer++) {
+            for (uint32_t row = 0; row < blockRows; row += rowsPerChunk) {
+                uint32_t rows = std::min(rowsPerChunk, blockRows - row);
+                uint32_t y = row * block.height;
+                bool first = level == 0 && layer == 0 && row == 0;
+                bool last = level + 1 == levels.size() && layer + 1 == _image->layers() && row + rows == blockRows;
+
+                auto region = ci.stagingRing->allocate(rows * rowSize);
+                memcpy(region.data, levels[level].data() + layer * layerSize + row * rowSize, static_cast<size_t>(region.size));
+
+                auto buff = ci.commandPool->singleTimeBegin();
+                if (first)
+                    buff->transitionImageLayout({
+                            .image = _image,
+                            .layout = vk::ImageLayout::eTransferDstOptimal,
+                            });
+                buff->copy({
+                        .buffer = region.buffer,
+                        .image = _image,
+                        .bufferOffset = region.offset,
+                        .imageOffset = { 0, (int32_t) y, 0 },
+                        .imageExtent = { levelExtent.width, std::min(rows * block.height, levelExtent.height - y), 1 },
+                        .mipLevel = level,
+                        .arrayLayer = layer,
+                        });
+                if (last && generate)
+                    buff->generateMips({ .image = _image });
+                else if (last)
+                    buff->transitionImageLayout({
+                            .image = _image,
+                            .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                            });
+                ci.commandPool->singleTimeEnd(buff, ci.queue, ci.stagingRing->seal());
+            }
+        }
+    }
 }
 
 vk::Sampler Texture_t::sampler() {
     return _sampler->raw();
 }
 
+// The image may have been moved by defragmentation, descriptors still using the old
+// view stay valid until the image retires its previous handle.
 vk::ImageView Texture_t::view() {
+    if (_viewGeneration != _image->generation()) {
+        _image->retain(_imageView);
+        _imageView = ImageView_t::conjure({
+                .image = _image->raw(),
+                .device = _device,
+                .format = _image->format(),
+                .range = _image->range(),
+                .type = _viewType,
+                });
+        _viewGeneration = _image->generation();
+    }
+
     return _imageView->raw();
 }
 
+uint64_t Texture_t::generation() {
+    return _image->generation();
+}
+
+UploadToken Texture_t::token() {
+    return _token;
+}
+
 vk::Image Texture_t::raw() {
     return _image->raw();
 }
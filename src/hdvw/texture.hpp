@@ -9,16 +9,33 @@
 #include <hdvw/allocator.hpp>
 #include <hdvw/image.hpp>
 #include <hdvw/buffer.hpp>
+#include <hdvw/stagingring.hpp>
+#include <hdvw/upload.hpp>
+#include <hdvw/ktx2.hpp>
+#include <hdvw/boxfilter.hpp>
 
+#include <cstddef>
 #include <memory>
+#include <span>
+#include <vector>
 
 namespace hd {
+    // Files ending in .ktx2 are uploaded as stored, anything else goes through stb_image
     struct TextureCreateInfo {
         const char* filename;
         CommandPool commandPool;
         Queue queue;
         Allocator allocator;
+        StagingRing stagingRing;
         Device device;
+        UploadContext uploadContext = nullptr;
+        UploadBatch uploadBatch = nullptr;
+        bool mipmaps = true;
+        // Wraps an image that was already uploaded, nothing is loaded from filename
+        Image image = nullptr;
+        UploadToken token = nullptr;
+        // Shared sampler, otherwise the texture makes its own
+        Sampler sampler = nullptr;
     };
 
     class Texture_t;
@@ -29,6 +46,16 @@ namespace hd {
             Image _image;
             ImageView _imageView;
             Sampler _sampler;
+            UploadToken _token = nullptr;
+            Device _device;
+            uint64_t _viewGeneration = 0;
+            vk::ImageViewType _viewType;
+
+            void loadImage(TextureCreateInfo& ci);
+
+            void loadKtx2(TextureCreateInfo& ci);
+
+            void upload(TextureCreateInfo& ci, const std::vector<std::span<const std::byte>>& levels, bool generate);
 
         public:
             static Texture conjure(TextureCreateInfo ci) {
@@ -41,6 +68,10 @@ namespace hd {
 
             vk::ImageView view();
 
+            uint64_t generation();
+
+            UploadToken token();
+
             vk::Image raw();
     };
 }
@@ -0,0 +1,212 @@
+#include <hdvw/textureloader.hpp>
+using namespace hd;
+
+#include <external/stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+TextureLoader_t::TextureLoader_t(TextureLoaderCreateInfo ci) {
+    _device = ci.device;
+    _allocator = ci.allocator;
+    _uploadContext = ci.uploadContext;
+    _stagingRing = _uploadContext->stagingRing();
+    _mipmaps = ci.mipmaps;
+    _sampler = ci.sampler;
+
+    _threadPool = ci.threadPool;
+    if (_threadPool == nullptr)
+        _threadPool = ThreadPool_t::conjure({});
+}
+
+// Only headers are read here, sizes have to be known before staging memory is handed out
+void TextureLoader_t::probe(Job& job) {
+    std::vector<vk::DeviceSize> sizes;
+
+    if (std::string_view(job.filename).ends_with(".ktx2")) {
+        job.ktx = Ktx2File_t::conjure({ .filename = job.filename.c_str() });
+        job.format = job.ktx->format();
+        job.extent = job.ktx->extent();
+        job.layers = job.ktx->layers();
+        job.mipLevels = job.ktx->mipLevels();
+        job.generate = _mipmaps && job.mipLevels == 1 && supportsLinearBlit(_device, job.format);
+
+        for (uint32_t level = 0; level < job.ktx->mipLevels(); level++)
+            sizes.push_back(job.ktx->level(level).size());
+    } else {
+        int width, height, channels;
+        if (!stbi_info(job.filename.c_str(), &width, &height, &channels))
+            throw std::runtime_error("failed to load texture image " + job.filename + "!");
+
+        job.format = vk::Format::eR8G8B8A8Srgb;
+        job.extent = { (uint32_t) width, (uint32_t) height };
+        job.layers = 1;
+
+        uint32_t levels = _mipmaps ? mipLevelCount(job.extent) : 1;
+        job.generate = levels > 1 && supportsLinearBlit(_device, job.format);
+        job.mipLevels = job.generate ? 1 : levels;
+
+        for (uint32_t level = 0; level < job.mipLevels; level++) {
+            vk::Extent2D extent = { std::max(job.extent.width >> level, 1u), std::max(job.extent.height >> level, 1u) };
+            sizes.push_back(extent.width * extent.height * 4);
+        }
+    }
+
+    for (auto size: sizes) {
+        job.levelOffsets.push_back(job.size);
+        job.levelSizes.push_back(size);
+        job.size = (job.size + size + 15) / 16 * 16;
+    }
+}
+
+// Runs on the pool, every job writes only to its own staging region
+void TextureLoader_t::decode(Job& job) {
+    auto staging = static_cast<char*>(job.region.data);
+
+    if (job.ktx != nullptr) {
+        for (uint32_t level = 0; level < job.levelSizes.size(); level++)
+            memcpy(staging + job.levelOffsets[level], job.ktx->level(level).data(), job.levelSizes[level]);
+        return;
+    }
+
+    // stb_image always allocates its own output, the chain below is filtered from that
+    int width, height, channels;
+    std::unique_ptr<stbi_uc, void (*)(void*)> pixels(
+            stbi_load(job.filename.c_str(), &width, &height, &channels, STBI_rgb_alpha), stbi_image_free);
+
+    if (!pixels || (uint32_t) width != job.extent.width || (uint32_t) height != job.extent.height)
+        throw std::runtime_error("failed to load texture image " + job.filename + "!");
+
+    memcpy(staging, pixels.get(), job.levelSizes[0]);
+
+    std::vector<uint8_t> previous;
+    for (uint32_t level = 1; level < job.levelSizes.size(); level++) {
+        vk::Extent2D parent = { std::max(job.extent.width >> (level - 1), 1u), std::max(job.extent.height >> (level - 1), 1u) };
+        vk::Extent2D extent = { std::max(job.extent.width >> level, 1u), std::max(job.extent.height >> level, 1u) };
+
+        previous = downsampleSrgba8(level == 1 ? pixels.get() : previous.data(), parent, extent);
+        memcpy(staging + job.levelOffsets[level], previous.data(), job.levelSizes[level]);
+    }
+}
+
+// Lets every task finish before reporting the first failure, jobs are referenced by the tasks
+void TextureLoader_t::wait(std::vector<std::future<void>>& futures) {
+    std::exception_ptr error;
+
+    for (auto& future: futures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+
+    futures.clear();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+std::vector<Texture> TextureLoader_t::load(const std::vector<std::string>& filenames) {
+    std::vector<Job> jobs(filenames.size());
+    std::vector<std::future<void>> futures;
+
+    for (size_t iter = 0; iter < jobs.size(); iter++) {
+        jobs[iter].filename = filenames[iter];
+        futures.push_back(_threadPool->submit([this, &job = jobs[iter]]() {
+                    probe(job);
+                    }));
+    }
+    wait(futures);
+
+    std::vector<Texture> textures;
+    textures.reserve(jobs.size());
+
+    auto batch = UploadBatch_t::conjure({ .uploadContext = _uploadContext });
+
+    size_t begin = 0;
+    while (begin < jobs.size()) {
+        // Larger than the whole ring, the regular path uploads it in chunks of rows
+        if (jobs[begin].size > _stagingRing->capacity()) {
+            textures.push_back(Texture_t::conjure({
+                        .filename = jobs[begin].filename.c_str(),
+                        .allocator = _allocator,
+                        .stagingRing = _stagingRing,
+                        .device = _device,
+                        .uploadContext = _uploadContext,
+                        .mipmaps = _mipmaps,
+                        .sampler = _sampler,
+                        }));
+            jobs[begin].ktx.reset();
+            begin++;
+            continue;
+        }
+
+        // The first region of a wave may wait for earlier uploads to give the ring back
+        size_t end = begin;
+        while (end < jobs.size() && jobs[end].size <= _stagingRing->capacity()
+                && (end == begin || _stagingRing->fits(jobs[end].size))) {
+            auto& job = jobs[end];
+
+            job.image = Image_t::conjure({
+                    .allocator = _allocator,
+                    .extent = job.extent,
+                    .format = job.format,
+                    .layers = job.layers,
+                    .mipLevels = job.generate ? mipLevelCount(job.extent) : job.mipLevels,
+                    .imageUsage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+                    .memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+                    .movable = true,
+                    });
+            job.region = _stagingRing->allocate(job.size);
+            end++;
+        }
+
+        for (size_t iter = begin; iter < end; iter++)
+            futures.push_back(_threadPool->submit([this, &job = jobs[iter]]() {
+                        decode(job);
+                        }));
+        wait(futures);
+
+        for (size_t iter = begin; iter < end; iter++) {
+            auto& job = jobs[iter];
+
+            for (uint32_t level = 0; level < job.levelSizes.size(); level++) {
+                vk::DeviceSize layerSize = job.levelSizes[level] / job.layers;
+                auto extent = job.image->extent(level);
+
+                for (uint32_t layer = 0; layer < job.layers; layer++) {
+                    auto region = job.region;
+                    region.offset += job.levelOffsets[level] + layer * layerSize;
+                    region.size = layerSize;
+                    region.data = static_cast<char*>(region.data) + job.levelOffsets[level] + layer * layerSize;
+
+                    batch->copy(region, job.image, { 0, 0, 0 }, { extent.width, extent.height, 1 }, level, layer);
+                }
+            }
+
+            if (job.generate)
+                batch->generateMips(job.image);
+        }
+
+        auto token = batch->flush();
+
+        for (size_t iter = begin; iter < end; iter++) {
+            textures.push_back(Texture_t::conjure({
+                        .filename = jobs[iter].filename.c_str(),
+                        .allocator = _allocator,
+                        .device = _device,
+                        .image = jobs[iter].image,
+                        .token = token,
+                        .sampler = _sampler,
+                        }));
+            jobs[iter].ktx.reset();
+        }
+
+        begin = end;
+    }
+
+    return textures;
+}
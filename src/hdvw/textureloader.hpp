@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/allocator.hpp>
+#include <hdvw/image.hpp>
+#include <hdvw/stagingring.hpp>
+#include <hdvw/upload.hpp>
+#include <hdvw/texture.hpp>
+#include <hdvw/threadpool.hpp>
+#include <hdvw/ktx2.hpp>
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hd {
+    struct TextureLoaderCreateInfo {
+        Device device;
+        Allocator allocator;
+        UploadContext uploadContext;
+        ThreadPool threadPool = nullptr;
+        bool mipmaps = true;
+        Sampler sampler = nullptr;
+    };
+
+    class TextureLoader_t;
+    typedef std::shared_ptr<TextureLoader_t> TextureLoader;
+
+    // Loads many textures at once. Files are split into waves that fit into the staging
+    // ring, every file of a wave is decoded on the pool straight into its staging region
+    // and the wave goes out as one upload batch.
+    class TextureLoader_t {
+        private:
+            struct Job {
+                std::string filename;
+                Ktx2File ktx = nullptr;
+                vk::Format format;
+                vk::Extent2D extent;
+                uint32_t layers;
+                // Levels that are staged, the rest of the chain is blitted when generate is set
+                uint32_t mipLevels;
+                bool generate = false;
+                std::vector<vk::DeviceSize> levelOffsets;
+                std::vector<vk::DeviceSize> levelSizes;
+                vk::DeviceSize size = 0;
+                Image image;
+                StagingRegion region;
+            };
+
+            Device _device;
+            Allocator _allocator;
+            UploadContext _uploadContext;
+            StagingRing _stagingRing;
+            ThreadPool _threadPool;
+            bool _mipmaps;
+            Sampler _sampler;
+
+            void probe(Job& job);
+
+            void decode(Job& job);
+
+            void wait(std::vector<std::future<void>>& futures);
+
+        public:
+            static TextureLoader conjure(TextureLoaderCreateInfo ci) {
+                return std::make_shared<TextureLoader_t>(ci);
+            }
+
+            TextureLoader_t(TextureLoaderCreateInfo ci);
+
+            // Textures come back in the order of filenames, with the token of their wave
+            std::vector<Texture> load(const std::vector<std::string>& filenames);
+    };
+}
@@ -0,0 +1,50 @@
+#include <hdvw/threadpool.hpp>
+using namespace hd;
+
+#include <algorithm>
+
+ThreadPool_t::ThreadPool_t(ThreadPoolCreateInfo ci) {
+    uint32_t threads = ci.threads;
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    _workers.reserve(threads);
+    for (uint32_t iter = 0; iter < threads; iter++)
+        _workers.emplace_back(&ThreadPool_t::work, this);
+}
+
+void ThreadPool_t::work() {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() {
+                    return _stopping || !_tasks.empty();
+                    });
+
+            if (_tasks.empty())
+                return;
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+uint32_t ThreadPool_t::size() {
+    return _workers.size();
+}
+
+ThreadPool_t::~ThreadPool_t() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+
+    _condition.notify_all();
+    for (auto& worker: _workers)
+        worker.join();
+}
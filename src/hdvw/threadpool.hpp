@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace hd {
+    struct ThreadPoolCreateInfo {
+        // Zero uses every hardware thread
+        uint32_t threads = 0;
+    };
+
+    class ThreadPool_t;
+    typedef std::shared_ptr<ThreadPool_t> ThreadPool;
+
+    // Fixed set of workers pulling tasks in submission order. Queued tasks still run
+    // when the pool is destroyed, exceptions end up in the returned future.
+    class ThreadPool_t {
+        private:
+            std::vector<std::thread> _workers;
+            std::deque<std::function<void()>> _tasks;
+            std::mutex _mutex;
+            std::condition_variable _condition;
+            bool _stopping = false;
+
+            void work();
+
+        public:
+            static ThreadPool conjure(ThreadPoolCreateInfo ci) {
+                return std::make_shared<ThreadPool_t>(ci);
+            }
+
+            ThreadPool_t(ThreadPoolCreateInfo ci);
+
+            template<class Task>
+            std::future<std::invoke_result_t<Task>> submit(Task task) {
+                using Result = std::invoke_result_t<Task>;
+
+                auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+                auto future = packaged->get_future();
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _tasks.push_back([packaged]() {
+                            (*packaged)();
+                            });
+                }
+
+                _condition.notify_one();
+                return future;
+            }
+
+            uint32_t size();
+
+            ~ThreadPool_t();
+    };
+}
@@ -0,0 +1,59 @@
+#include <hdvw/uniformring.hpp>
+using namespace hd;
+
+#include <cstring>
+#include <stdexcept>
+
+UniformRing_t::UniformRing_t(UniformRingCreateInfo ci) {
+    _frames = ci.frames;
+    _alignment = ci.device->physical().getProperties().limits.minUniformBufferOffsetAlignment;
+    _frameSize = (ci.frameSize + _alignment - 1) / _alignment * _alignment;
+
+    _buffer = Buffer_t::conjure({
+            .allocator = ci.allocator,
+            .size = _frameSize * _frames,
+            .bufferUsage = vk::BufferUsageFlagBits::eUniformBuffer,
+            .memoryUsage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+            .mapped = true,
+            .pool = ci.pool,
+            });
+
+    _data = static_cast<char*>(_buffer->data());
+}
+
+void UniformRing_t::begin(uint32_t frame) {
+    _frame = frame % _frames;
+    _head = 0;
+}
+
+uint32_t UniformRing_t::push(const void* data, vk::DeviceSize size) {
+    if (_head + size > _frameSize)
+        throw std::runtime_error("Uniform ring frame region is full");
+
+    vk::DeviceSize offset = _frame * _frameSize + _head;
+    memcpy(_data + offset, data, static_cast<size_t>(size));
+
+    _head += (size + _alignment - 1) / _alignment * _alignment;
+    return static_cast<uint32_t>(offset);
+}
+
+void UniformRing_t::flush() {
+    _buffer->flush(_frame * _frameSize, _head);
+}
+
+vk::DescriptorBufferInfo UniformRing_t::descriptor(vk::DeviceSize range) {
+    vk::DescriptorBufferInfo bi = {};
+    bi.buffer = _buffer->raw();
+    bi.offset = 0;
+    bi.range = range;
+
+    return bi;
+}
+
+vk::DeviceSize UniformRing_t::alignment() {
+    return _alignment;
+}
+
+vk::Buffer UniformRing_t::raw() {
+    return _buffer->raw();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/allocator.hpp>
+#include <hdvw/buffer.hpp>
+
+#include <memory>
+#include <string>
+
+namespace hd {
+    struct UniformRingCreateInfo {
+        Device device;
+        Allocator allocator;
+        uint32_t frames;
+        vk::DeviceSize frameSize = 256 * 1024;
+        std::string pool = "";
+    };
+
+    class UniformRing_t;
+    typedef std::shared_ptr<UniformRing_t> UniformRing;
+
+    // One mapped uniform buffer split into a region per frame in flight. Bind it once
+    // as eUniformBufferDynamic and pass the offsets returned by push() at draw time.
+    class UniformRing_t {
+        private:
+            Buffer _buffer;
+            char* _data;
+
+            vk::DeviceSize _alignment;
+            vk::DeviceSize _frameSize;
+            uint32_t _frames;
+
+            uint32_t _frame = 0;
+            vk::DeviceSize _head = 0;
+
+        public:
+            static UniformRing conjure(UniformRingCreateInfo ci) {
+                return std::make_shared<UniformRing_t>(ci);
+            }
+
+            UniformRing_t(UniformRingCreateInfo ci);
+
+            void begin(uint32_t frame);
+
+            uint32_t push(const void* data, vk::DeviceSize size);
+
+            template<class T>
+            uint32_t push(const T& value) {
+                return push(&value, sizeof(T));
+            }
+
+            void flush();
+
+            vk::DescriptorBufferInfo descriptor(vk::DeviceSize range);
+
+            vk::DeviceSize alignment();
+
+            vk::Buffer raw();
+    };
+}
@@ -0,0 +1,405 @@
+#include <hdvw/upload.hpp>
+using namespace hd;
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+UploadToken_t::UploadToken_t(UploadTokenCreateInfo ci) {
+    _fence = ci.fence;
+    _commandBuffers = ci.commandBuffers;
+    _semaphore = ci.semaphore;
+}
+
+bool UploadToken_t::ready() {
+    return _fence->signaled();
+}
+
+void UploadToken_t::wait() {
+    _fence->wait();
+}
+
+void UploadToken_t::release() {
+    _commandBuffers.clear();
+    _semaphore.reset();
+}
+
+Fence UploadToken_t::fence() {
+    return _fence;
+}
+
+UploadContext_t::UploadContext_t(UploadContextCreateInfo ci) {
+    _device = ci.device;
+    _stagingRing = ci.stagingRing;
+    _transferQueue = ci.transferQueue;
+    _graphicsQueue = ci.graphicsQueue;
+
+    _transferFamily = _device->indices().transferFamily.value();
+    _graphicsFamily = _device->indices().graphicsFamily.value();
+
+    _transferPool = CommandPool_t::conjure({
+            .device = _device,
+            .family = PoolFamily::eTransfer,
+            .flags = vk::CommandPoolCreateFlagBits::eTransient,
+            });
+
+    if (_transferFamily != _graphicsFamily)
+        _graphicsPool = CommandPool_t::conjure({
+                .device = _device,
+                .family = PoolFamily::eGraphics,
+                .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                });
+}
+
+CommandBuffer UploadContext_t::begin() {
+    return _transferPool->singleTimeBegin();
+}
+
+UploadToken UploadContext_t::submit(UploadSubmitInfo si) {
+    collect();
+
+    bool dedicated = _transferFamily != _graphicsFamily;
+
+    std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+    bufferBarriers.reserve(si.buffers.size());
+    for (auto& buffer: si.buffers) {
+        vk::BufferMemoryBarrier barrier = {};
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+        barrier.srcQueueFamilyIndex = (dedicated && !buffer->concurrent()) ? _transferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = (dedicated && !buffer->concurrent()) ? _graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = buffer->raw();
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        bufferBarriers.push_back(barrier);
+    }
+
+    auto mipmapped = [&](Image& image) {
+        return std::find(si.mipmapped.begin(), si.mipmapped.end(), image) != si.mipmapped.end();
+    };
+
+    // Mipmapped images stay in eTransferDstOptimal, generateMips() takes them the rest of the way
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(si.images.size());
+    for (auto& image: si.images) {
+        if (!dedicated && mipmapped(image))
+            continue;
+
+        vk::ImageMemoryBarrier barrier = {};
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        barrier.oldLayout = image->layout();
+        barrier.newLayout = mipmapped(image) ? vk::ImageLayout::eTransferDstOptimal : vk::ImageLayout::eShaderReadOnlyOptimal;
+        barrier.srcQueueFamilyIndex = dedicated ? _transferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = dedicated ? _graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image->raw();
+        barrier.subresourceRange = image->range();
+        imageBarriers.push_back(barrier);
+    }
+
+    bool handover = !bufferBarriers.empty() || !imageBarriers.empty() || !si.mipmapped.empty();
+    UploadToken token;
+
+    if (!dedicated || !handover) {
+        if (handover)
+            si.commandBuffer->raw().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                    vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags{0},
+                    nullptr, bufferBarriers, imageBarriers);
+        for (auto& image: si.mipmapped)
+            si.commandBuffer->generateMips({ .image = image });
+        si.commandBuffer->end();
+
+        auto raw = si.commandBuffer->raw();
+        vk::SubmitInfo submitInfo = {};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &raw;
+
+        // A shared family goes through the graphics queue itself, so the barrier above
+        // orders the copies before every later graphics and compute submission
+        auto fence = _stagingRing->seal();
+        (dedicated ? _transferQueue : _graphicsQueue)->submit(submitInfo, fence);
+
+        token = UploadToken_t::conjure({
+                .fence = fence,
+                .commandBuffers = { si.commandBuffer },
+                });
+    } else {
+        // Release on the transfer queue
+        for (auto& barrier: bufferBarriers)
+            barrier.dstAccessMask = vk::AccessFlags{0};
+        for (auto& barrier: imageBarriers)
+            barrier.dstAccessMask = vk::AccessFlags{0};
+
+        si.commandBuffer->raw().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags{0},
+                nullptr, bufferBarriers, imageBarriers);
+        si.commandBuffer->end();
+
+        auto semaphore = Semaphore_t::conjure({ .device = _device });
+        auto semaphoreRaw = semaphore->raw();
+
+        auto transferRaw = si.commandBuffer->raw();
+        vk::SubmitInfo transferInfo = {};
+        transferInfo.commandBufferCount = 1;
+        transferInfo.pCommandBuffers = &transferRaw;
+        transferInfo.signalSemaphoreCount = 1;
+        transferInfo.pSignalSemaphores = &semaphoreRaw;
+
+        _transferQueue->submit(transferInfo, _stagingRing->seal());
+
+        // Acquire on the graphics queue
+        for (auto& barrier: bufferBarriers) {
+            barrier.srcAccessMask = vk::AccessFlags{0};
+            barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+        }
+        for (auto& barrier: imageBarriers) {
+            barrier.srcAccessMask = vk::AccessFlags{0};
+            barrier.dstAccessMask = barrier.newLayout == vk::ImageLayout::eTransferDstOptimal
+                ? vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite
+                : vk::AccessFlagBits::eShaderRead;
+        }
+
+        auto acquire = _graphicsPool->singleTimeBegin();
+        acquire->raw().pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags{0},
+                nullptr, bufferBarriers, imageBarriers);
+        for (auto& image: si.mipmapped)
+            acquire->generateMips({ .image = image });
+        acquire->end();
+
+        vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+        auto acquireRaw = acquire->raw();
+        vk::SubmitInfo acquireInfo = {};
+        acquireInfo.waitSemaphoreCount = 1;
+        acquireInfo.pWaitSemaphores = &semaphoreRaw;
+        acquireInfo.pWaitDstStageMask = &waitStage;
+        acquireInfo.commandBufferCount = 1;
+        acquireInfo.pCommandBuffers = &acquireRaw;
+
+        auto fence = Fence_t::conjure({ .device = _device, .state = FenceState::eIdle });
+        _graphicsQueue->submit(acquireInfo, fence);
+
+        token = UploadToken_t::conjure({
+                .fence = fence,
+                .commandBuffers = { si.commandBuffer, acquire },
+                .semaphore = semaphore,
+                });
+    }
+
+    for (auto& image: si.images)
+        image->setLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    _inFlight.push_back(token);
+    return token;
+}
+
+void UploadContext_t::collect() {
+    auto done = std::remove_if(_inFlight.begin(), _inFlight.end(), [](UploadToken& token) {
+            if (!token->ready())
+                return false;
+
+            token->release();
+            return true;
+            });
+
+    _inFlight.erase(done, _inFlight.end());
+}
+
+void UploadContext_t::wait() {
+    for (auto& token: _inFlight) {
+        token->wait();
+        token->release();
+    }
+
+    _inFlight.clear();
+}
+
+bool UploadContext_t::idle() {
+    return _inFlight.empty();
+}
+
+StagingRing UploadContext_t::stagingRing() {
+    return _stagingRing;
+}
+
+UploadContext_t::~UploadContext_t() {
+    wait();
+}
+
+UploadBatch_t::UploadBatch_t(UploadBatchCreateInfo ci) {
+    _context = ci.uploadContext;
+    _stagingRing = _context->stagingRing();
+}
+
+bool UploadBatch_t::pending() {
+    return !_bufferCopies.empty() || !_imageCopies.empty() || !_buffers.empty() || !_images.empty();
+}
+
+StagingRegion UploadBatch_t::stage(vk::DeviceSize size, vk::DeviceSize alignment) {
+    if (pending() && !_stagingRing->fits(size, alignment))
+        flush();
+
+    return _stagingRing->allocate(size, alignment);
+}
+
+void UploadBatch_t::copy(StagingRegion region, Buffer buffer, vk::DeviceSize offset) {
+    vk::BufferCopy copyRegion = {};
+    copyRegion.srcOffset = region.offset;
+    copyRegion.dstOffset = offset;
+    copyRegion.size = region.size;
+
+    _bufferCopies.push_back({ buffer, copyRegion });
+
+    if (std::find(_buffers.begin(), _buffers.end(), buffer) == _buffers.end())
+        _buffers.push_back(buffer);
+}
+
+void UploadBatch_t::copy(StagingRegion region, Image image, vk::Offset3D offset, vk::Extent3D extent,
+        uint32_t level, uint32_t layer) {
+    // The whole image moves to eTransferDstOptimal, mip levels left unwritten are blitted into later
+    for (uint32_t iter = 0; iter < image->mipLevels(); iter++) {
+        if (image->layout(iter) != vk::ImageLayout::eTransferDstOptimal)
+            _transitions.push_back({ image, iter, image->layout(iter) });
+    }
+    image->setLayout(vk::ImageLayout::eTransferDstOptimal);
+
+    vk::BufferImageCopy copyRegion = {};
+    copyRegion.bufferOffset = region.offset;
+    copyRegion.bufferRowLength = 0;
+    copyRegion.bufferImageHeight = 0;
+
+    copyRegion.imageSubresource.aspectMask = image->range().aspectMask;
+    copyRegion.imageSubresource.mipLevel = level;
+    copyRegion.imageSubresource.baseArrayLayer = layer;
+    copyRegion.imageSubresource.layerCount = 1;
+
+    copyRegion.imageOffset = offset;
+    copyRegion.imageExtent = extent;
+
+    _imageCopies.push_back({ image, copyRegion });
+
+    if (std::find(_images.begin(), _images.end(), image) == _images.end())
+        _images.push_back(image);
+}
+
+void UploadBatch_t::upload(Buffer buffer, const void* data, vk::DeviceSize size, vk::DeviceSize offset) {
+    auto bytes = static_cast<const char*>(data);
+
+    for (vk::DeviceSize done = 0; done < size; done += _stagingRing->capacity()) {
+        vk::DeviceSize chunk = std::min(size - done, _stagingRing->capacity());
+
+        auto region = stage(chunk);
+        memcpy(region.data, bytes + done, static_cast<size_t>(chunk));
+        copy(region, buffer, offset + done);
+    }
+}
+
+void UploadBatch_t::upload(Image image, const void* data, vk::DeviceSize size, uint32_t level) {
+    auto bytes = static_cast<const char*>(data);
+    auto extent = image->extent(level);
+
+    // Compressed formats are chunked by rows of blocks, not rows of texels
+    auto block = formatBlockExtent(image->format());
+    uint32_t blockRows = (extent.height + block.height - 1) / block.height;
+
+    vk::DeviceSize layerSize = size / image->layers();
+    vk::DeviceSize rowSize = layerSize / blockRows;
+
+    uint32_t rowsPerChunk = std::min<vk::DeviceSize>(_stagingRing->capacity() / rowSize, blockRows);
+    if (rowsPerChunk == 0)
+        throw std::runtime_error("Image row does not fit into the staging ring");
+
+    for (uint32_t layer = 0; layer < image->layers(); layer++) {
+        for (uint32_t row = 0; row < blockRows; row += rowsPerChunk) {
+            uint32_t rows = std::min(rowsPerChunk, blockRows - row);
+            uint32_t y = row * block.height;
+
+            auto region = stage(rows * rowSize);
+            memcpy(region.data, bytes + layer * layerSize + row * rowSize, static_cast<size_t>(region.size));
+            copy(region, image, { 0, (int32_t) y, 0 }, { extent.width, std::min(rows * block.height, extent.height - y), 1 },
+                    level, layer);
+        }
+    }
+}
+
+// Blits the chain from level 0 once the batch is flushed, so the format needs linear blit support
+void UploadBatch_t::generateMips(Image image) {
+    if (std::find(_images.begin(), _images.end(), image) == _images.end())
+        throw std::invalid_argument("Mips can only be generated for images uploaded in this batch");
+
+    if (std::find(_mipmapped.begin(), _mipmapped.end(), image) == _mipmapped.end())
+        _mipmapped.push_back(image);
+}
+
+UploadToken UploadBatch_t::flush() {
+    if (!pending())
+        return _token;
+
+    auto cmd = _context->begin();
+    auto raw = cmd->raw();
+    auto src = _stagingRing->buffer()->raw();
+
+    if (!_transitions.empty()) {
+        std::vector<vk::ImageMemoryBarrier> barriers;
+        barriers.reserve(_transitions.size());
+
+        for (auto& transition: _transitions) {
+            vk::ImageMemoryBarrier barrier = {};
+            barrier.srcAccessMask = vk::AccessFlags{0};
+            barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+            barrier.oldLayout = transition.layout;
+            barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = transition.image->raw();
+            barrier.subresourceRange = transition.image->range();
+            barrier.subresourceRange.baseMipLevel = transition.level;
+            barrier.subresourceRange.levelCount = 1;
+            barriers.push_back(barrier);
+        }
+
+        raw.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                vk::DependencyFlags{0}, nullptr, nullptr, barriers);
+    }
+
+    // Neighbouring copies into the same destination go out as one command
+    std::vector<vk::BufferCopy> bufferRegions;
+    for (size_t iter = 0; iter < _bufferCopies.size(); iter++) {
+        bufferRegions.push_back(_bufferCopies[iter].region);
+
+        if (iter + 1 == _bufferCopies.size() || _bufferCopies[iter + 1].buffer != _bufferCopies[iter].buffer) {
+            raw.copyBuffer(src, _bufferCopies[iter].buffer->raw(), bufferRegions);
+            bufferRegions.clear();
+        }
+    }
+
+    std::vector<vk::BufferImageCopy> imageRegions;
+    for (size_t iter = 0; iter < _imageCopies.size(); iter++) {
+        imageRegions.push_back(_imageCopies[iter].region);
+
+        if (iter + 1 == _imageCopies.size() || _imageCopies[iter + 1].image != _imageCopies[iter].image) {
+            raw.copyBufferToImage(src, _imageCopies[iter].image->raw(), vk::ImageLayout::eTransferDstOptimal, imageRegions);
+            imageRegions.clear();
+        }
+    }
+
+    _token = _context->submit({
+            .commandBuffer = cmd,
+            .buffers = _buffers,
+            .images = _images,
+            .mipmapped = _mipmapped,
+            });
+
+    _bufferCopies.clear();
+    _imageCopies.clear();
+    _transitions.clear();
+    _buffers.clear();
+    _images.clear();
+    _mipmapped.clear();
+
+    return _token;
+}
+
+UploadToken UploadBatch_t::token() {
+    return _token;
+}
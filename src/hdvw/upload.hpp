@@ -0,0 +1,176 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/queue.hpp>
+#include <hdvw/fence.hpp>
+#include <hdvw/semaphore.hpp>
+#include <hdvw/commandpool.hpp>
+#include <hdvw/commandbuffer.hpp>
+#include <hdvw/buffer.hpp>
+#include <hdvw/image.hpp>
+#include <hdvw/stagingring.hpp>
+
+#include <vector>
+#include <memory>
+
+namespace hd {
+    struct UploadTokenCreateInfo {
+        Fence fence;
+        std::vector<CommandBuffer> commandBuffers;
+        Semaphore semaphore = nullptr;
+    };
+
+    class UploadToken_t;
+    typedef std::shared_ptr<UploadToken_t> UploadToken;
+
+    class UploadToken_t {
+        private:
+            Fence _fence;
+            std::vector<CommandBuffer> _commandBuffers;
+            Semaphore _semaphore;
+
+        public:
+            static UploadToken conjure(UploadTokenCreateInfo ci) {
+                return std::make_shared<UploadToken_t>(ci);
+            }
+
+            UploadToken_t(UploadTokenCreateInfo ci);
+
+            bool ready();
+
+            void wait();
+
+            void release();
+
+            Fence fence();
+    };
+
+    struct UploadContextCreateInfo {
+        Device device;
+        StagingRing stagingRing;
+        Queue transferQueue;
+        Queue graphicsQueue;
+    };
+
+    struct UploadSubmitInfo {
+        CommandBuffer commandBuffer;
+        std::vector<Buffer> buffers = {};
+        std::vector<Image> images = {};
+        std::vector<Image> mipmapped = {};
+    };
+
+    class UploadContext_t;
+    typedef std::shared_ptr<UploadContext_t> UploadContext;
+
+    // Records copies on the transfer family and submits them without waiting. When the
+    // transfer family is the graphics family the copies are submitted on the graphics queue.
+    // Buffers and images listed on submit are handed over to the graphics family
+    // (concurrent buffers only get a barrier), images end up in eShaderReadOnlyOptimal.
+    // Mipmapped images have their chain blitted from level 0 on the graphics family.
+    class UploadContext_t {
+        private:
+            Device _device;
+            StagingRing _stagingRing;
+            Queue _transferQueue;
+            Queue _graphicsQueue;
+            CommandPool _transferPool;
+            CommandPool _graphicsPool;
+
+            uint32_t _transferFamily;
+            uint32_t _graphicsFamily;
+
+            std::vector<UploadToken> _inFlight;
+
+        public:
+            static UploadContext conjure(UploadContextCreateInfo ci) {
+                return std::make_shared<UploadContext_t>(ci);
+            }
+
+            UploadContext_t(UploadContextCreateInfo ci);
+
+            CommandBuffer begin();
+
+            UploadToken submit(UploadSubmitInfo si);
+
+            void collect();
+
+            void wait();
+
+            bool idle();
+
+            StagingRing stagingRing();
+
+            ~UploadContext_t();
+    };
+
+    struct UploadBatchCreateInfo {
+        UploadContext uploadContext;
+    };
+
+    class UploadBatch_t;
+    typedef std::shared_ptr<UploadBatch_t> UploadBatch;
+
+    // Collects copies from many uploads and submits them through the context in
+    // one command buffer, with one transition barrier and one hand-over barrier.
+    // Only one batch should stage from a ring at a time, because seal() covers
+    // everything allocated since the previous seal.
+    class UploadBatch_t {
+        private:
+            struct PendingBufferCopy {
+                Buffer buffer;
+                vk::BufferCopy region;
+            };
+
+            struct PendingImageCopy {
+                Image image;
+                vk::BufferImageCopy region;
+            };
+
+            struct PendingTransition {
+                Image image;
+                uint32_t level;
+                vk::ImageLayout layout;
+            };
+
+            UploadContext _context;
+            StagingRing _stagingRing;
+
+            std::vector<PendingBufferCopy> _bufferCopies;
+            std::vector<PendingImageCopy> _imageCopies;
+            std::vector<PendingTransition> _transitions;
+            std::vector<Buffer> _buffers;
+            std::vector<Image> _images;
+            std::vector<Image> _mipmapped;
+
+            UploadToken _token = nullptr;
+
+            bool pending();
+
+        public:
+            static UploadBatch conjure(UploadBatchCreateInfo ci) {
+                return std::make_shared<UploadBatch_t>(ci);
+            }
+
+            UploadBatch_t(UploadBatchCreateInfo ci);
+
+            StagingRegion stage(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+            void copy(StagingRegion region, Buffer buffer, vk::DeviceSize offset = 0);
+
+            void copy(StagingRegion region, Image image, vk::Offset3D offset, vk::Extent3D extent,
+                    uint32_t level = 0, uint32_t layer = 0);
+
+            void upload(Buffer buffer, const void* data, vk::DeviceSize size, vk::DeviceSize offset = 0);
+
+            // Data holds every layer of the level, one after another
+            void upload(Image image, const void* data, vk::DeviceSize size, uint32_t level = 0);
+
+            void generateMips(Image image);
+
+            UploadToken flush();
+
+            UploadToken token();
+    };
+}
@@ -0,0 +1,192 @@
+#include <water/shallowwater.hpp>
+using namespace hd;
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+// Shallower water is treated as dry, its velocity is meaningless
+const float DRY_TOLERANCE = 1e-4f;
+
+ShallowWater_t::ShallowWater_t(ShallowWaterCreateInfo ci) {
+    _device = ci.device;
+    _queue = ci.queue;
+    _width = ci.width;
+    _height = ci.height;
+    _cellSize = ci.cellSize;
+    _gravity = ci.gravity;
+
+    size_t cells = size_t(_width) * _height;
+    if (cells == 0)
+        throw std::invalid_argument("The water grid is empty");
+    if ((!ci.bathymetry.empty() && ci.bathymetry.size() != cells) || (!ci.depth.empty() && ci.depth.size() != cells))
+        throw std::invalid_argument("Bathymetry and depth need one value per cell");
+
+    std::vector<std::array<float, 4>> initial(cells);
+    for (size_t cell = 0; cell < cells; cell++)
+        initial[cell] = {
+            ci.depth.empty() ? 0.0f : std::max(ci.depth[cell], 0.0f),
+            0.0f,
+            0.0f,
+            ci.bathymetry.empty() ? 0.0f : ci.bathymetry[cell],
+        };
+
+    // Shared with the transfer family so the upload needs no ownership transfer
+    auto indices = _device->indices();
+    std::vector<uint32_t> families = { indices.graphicsFamily.value() };
+    if (indices.transferFamily.has_value() && indices.transferFamily.value() != indices.graphicsFamily.value())
+        families.push_back(indices.transferFamily.value());
+
+    auto uploadBatch = UploadBatch_t::conjure({ .uploadContext = ci.uploadContext });
+    for (auto& state: _state) {
+        state = Buffer_t::conjure({
+                .allocator = ci.allocator,
+                .size = sizeof(initial[0]) * cells,
+                .bufferUsage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                .memoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+                .queueFamilies = families,
+                });
+
+        uploadBatch->upload(state, initial.data(), state->size());
+    }
+    uploadBatch->flush()->wait();
+
+    _shader = Shader_t::conjure({
+            .device = _device,
+            .filename = "shaders/shallowwater.comp.spv",
+            .stage = vk::ShaderStageFlagBits::eCompute,
+            });
+
+    _specialization = Specialization_t::conjure(Constants{ static_cast<uint32_t>(ci.boundary) }, &Constants::boundary);
+
+    auto layout = ci.layoutCache->reflect({ .shaders = { _shader } });
+    _descriptorLayout = layout.descriptorLayouts.at(0);
+
+    _pipeline = ComputePipeline_t::conjure({
+            .device = _device,
+            .pipelineLayout = layout.pipelineLayout,
+            .shader = _shader,
+            .specialization = _specialization,
+            .pipelineCache = ci.pipelineCache,
+            });
+
+    // The last slot belongs to step()
+    uint32_t slots = ci.frames + 1;
+    _descriptorPool = DescriptorPool_t::conjure({
+            .device = _device,
+            .layouts = {{ _descriptorLayout, 2 }},
+            .instances = slots,
+            });
+
+    _descriptorSets = _descriptorPool->allocate(2, _descriptorLayout);
+    _generations.resize(slots);
+    for (uint32_t slot = 0; slot < slots; slot++)
+        writeDescriptors(slot);
+
+    _commandBuffer = ci.commandPool->allocate(1).at(0);
+    _fence = Fence_t::conjure({ .device = _device, .state = FenceState::eIdle });
+}
+
+// Set 2 * slot reads the first buffer and writes the second, the next one goes back
+void ShallowWater_t::writeDescriptors(uint32_t slot) {
+    for (uint32_t direction = 0; direction < 2; direction++) {
+        for (uint32_t binding = 0; binding < 2; binding++) {
+            vk::WriteDescriptorSet ws = {};
+            ws.dstBinding = binding;
+            ws.dstArrayElement = 0;
+            ws.descriptorType = vk::DescriptorType::eStorageBuffer;
+            ws.descriptorCount = 1;
+
+            auto& buffer = _state[(direction + binding) % 2];
+            _descriptorSets[2 * slot + direction]->update({
+                    .writeSet = ws,
+                    .bufferInfo = { buffer->raw(), 0, VK_WHOLE_SIZE },
+                    });
+        }
+    }
+
+    _generations[slot] = { _state[0]->generation(), _state[1]->generation() };
+}
+
+void ShallowWater_t::recordSteps(CommandBuffer cmd, uint32_t slot, float dt, uint32_t steps) {
+    // Defragmentation may have moved the buffers since this slot was last used
+    if (_generations[slot] != std::array<uint64_t, 2>{ _state[0]->generation(), _state[1]->generation() })
+        writeDescriptors(slot);
+
+    // Earlier steps and defragmentation copies have to land before the first read
+    cmd->barrier(BarrierCreateInfo{
+            .srcAccess = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+            .dstAccess = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            .srcStage = vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+            .dstStage = vk::PipelineStageFlagBits::eComputeShader,
+            });
+
+    StepConstants constants = { _width, _height, dt, _cellSize, _gravity, DRY_TOLERANCE };
+
+    _pipeline->bind(cmd);
+    cmd->pushConstants(_pipeline->layout()->raw(), vk::ShaderStageFlagBits::eCompute, constants);
+
+    for (uint32_t iter = 0; iter < steps; iter++) {
+        cmd->raw().bindDescriptorSets(vk::PipelineBindPoint::eCompute, _pipeline->layout()->raw(), 0,
+                _descriptorSets[2 * slot + _current]->raw(), nullptr);
+        _pipeline->dispatch(cmd, _width, _height);
+
+        _current = 1 - _current;
+
+        // Also orders the next step's writes after this step's reads of the other buffer
+        if (iter + 1 < steps)
+            cmd->barrier(BufferBarrierInfo{ .buffer = _state[_current] });
+    }
+
+    _time += double(dt) * steps;
+}
+
+void ShallowWater_t::record(CommandBuffer cmd, uint32_t frame, float dt, uint32_t steps) {
+    if (frame + 1 >= _generations.size())
+        throw std::out_of_range("No descriptor slot for this frame");
+
+    recordSteps(cmd, frame, dt, steps);
+}
+
+void ShallowWater_t::step(float dt, uint32_t steps) {
+    _commandBuffer->reset(false);
+    _commandBuffer->begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    recordSteps(_commandBuffer, _generations.size() - 1, dt, steps);
+    _commandBuffer->end();
+
+    auto raw = _commandBuffer->raw();
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &raw;
+
+    auto start = std::chrono::steady_clock::now();
+    _queue->submit(submitInfo, _fence);
+    _fence->wait();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    _fence->reset();
+    _cellUpdatesPerSecond = double(_width) * _height * steps / std::max(elapsed.count(), 1e-9);
+}
+
+// Unsplit in two dimensions, so a quarter of the one dimensional CFL limit
+float ShallowWater_t::stableTimeStep(float maxDepth, float maxSpeed) {
+    float wave = maxSpeed + std::sqrt(_gravity * maxDepth);
+    return wave > 0.0f ? 0.25f * _cellSize / wave : INFINITY;
+}
+
+double ShallowWater_t::cellUpdatesPerSecond() {
+    return _cellUpdatesPerSecond;
+}
+
+double ShallowWater_t::time() {
+    return _time;
+}
+
+Buffer ShallowWater_t::state() {
+    return _state[_current];
+}
+
+vk::Extent2D ShallowWater_t::extent() {
+    return { _width, _height };
+}
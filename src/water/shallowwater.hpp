@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <hdvw/device.hpp>
+#include <hdvw/allocator.hpp>
+#include <hdvw/queue.hpp>
+#include <hdvw/fence.hpp>
+#include <hdvw/commandpool.hpp>
+#include <hdvw/commandbuffer.hpp>
+#include <hdvw/buffer.hpp>
+#include <hdvw/upload.hpp>
+#include <hdvw/shader.hpp>
+#include <hdvw/specialization.hpp>
+#include <hdvw/layoutcache.hpp>
+#include <hdvw/pipelinecache.hpp>
+#include <hdvw/pipeline.hpp>
+#include <hdvw/descriptorpool.hpp>
+#include <hdvw/descriptorset.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace hd {
+    enum class WaterBoundary : uint32_t {
+        eReflective,
+        eTransmissive,
+        ePeriodic,
+    };
+
+    struct ShallowWaterCreateInfo {
+        Device device;
+        Allocator allocator;
+        UploadContext uploadContext;
+        LayoutCache layoutCache;
+        // Used by step(), the family must support compute
+        Queue queue;
+        CommandPool commandPool;
+        PipelineCache pipelineCache = nullptr;
+        uint32_t width;
+        uint32_t height;
+        float cellSize = 1.0f;
+        float gravity = 9.81f;
+        WaterBoundary boundary = WaterBoundary::eReflective;
+        // Row major, width * height values each, empty means a flat bed or no water
+        std::vector<float> bathymetry = {};
+        std::vector<float> depth = {};
+        // Slots for record(), one per frame in flight
+        uint32_t frames = 1;
+    };
+
+    class ShallowWater_t;
+    typedef std::shared_ptr<ShallowWater_t> ShallowWater;
+
+    // Finite volume shallow water solver on the GPU. Depth, momentum and bed elevation
+    // live in one vec4 per cell, ping-ponged between two storage buffers every step.
+    // The time step isn't limited for you, stay under stableTimeStep().
+    class ShallowWater_t {
+        private:
+            struct Constants {
+                uint32_t boundary;
+            };
+
+            struct StepConstants {
+                uint32_t width;
+                uint32_t height;
+                float dt;
+                float cellSize;
+                float gravity;
+                float dryTolerance;
+            };
+
+            Device _device;
+            Queue _queue;
+            Fence _fence;
+            CommandBuffer _commandBuffer;
+
+            uint32_t _width;
+            uint32_t _height;
+            float _cellSize;
+            float _gravity;
+
+            std::array<Buffer, 2> _state;
+            uint32_t _current = 0;
+
+            Shader _shader;
+            Specialization _specialization;
+            ComputePipeline _pipeline;
+            DescriptorLayout _descriptorLayout;
+            DescriptorPool _descriptorPool;
+            // Two per slot, one for each direction of the ping-pong
+            std::vector<DescriptorSet> _descriptorSets;
+            std::vector<std::array<uint64_t, 2>> _generations;
+
+            double _time = 0.0;
+            double _cellUpdatesPerSecond = 0.0;
+
+            void writeDescriptors(uint32_t slot);
+
+            void recordSteps(CommandBuffer cmd, uint32_t slot, float dt, uint32_t steps);
+
+        public:
+            static ShallowWater conjure(ShallowWaterCreateInfo ci) {
+                return std::make_shared<ShallowWater_t>(ci);
+            }
+
+            ShallowWater_t(ShallowWaterCreateInfo ci);
+
+            // Records the steps into a command buffer of the caller, frame picks the descriptor
+            // slot and may only be reused once that frame's previous submission has finished.
+            // Reads of state() after it need a barrier from the compute shader stage.
+            void record(CommandBuffer cmd, uint32_t frame, float dt, uint32_t steps = 1);
+
+            // Submits the steps in one command buffer and waits for them
+            void step(float dt, uint32_t steps = 1);
+
+            // Largest stable step for the given deepest water and fastest flow
+            float stableTimeStep(float maxDepth, float maxSpeed = 0.0f);
+
+            // Measured over the last step() from submission to completion
+            double cellUpdatesPerSecond();
+
+            double time();
+
+            // Holds the latest state after the recorded steps have run
+            Buffer state();
+
+            vk::Extent2D extent();
+    };
+}